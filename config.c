@@ -18,6 +18,7 @@
 
 #include <ctype.h>
 #include <float.h> // FLT_max/min
+#include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 #include <strings.h>
@@ -98,89 +99,85 @@ int sl_get_keyval(const char *pair, char key[SL_KEY_LEN], char value[SL_VAL_LEN]
     return ret;
 }
 
-// Read key/value from file; return -1 when file is over
-static int read_key(FILE *file, char key[SL_KEY_LEN], char value[SL_VAL_LEN]){
-    char *line = NULL;
-    size_t n = 0;
-    ssize_t got = getline(&line, &n, file);
-    if(!line) return 0;
-    if(got < 0){ // EOF
-        free(line);
-        return -1;
+// Read key/value from file into line buffer `*line` (reused by next calls); return -1 when file is over
+static int read_key(FILE *file, char **line, size_t *n, char key[SL_KEY_LEN], char value[SL_VAL_LEN]){
+    ssize_t got = getline(line, n, file);
+    if(got < 0) return -1; // EOF
+    return sl_get_keyval(*line, key, value);
+}
+
+SL_VEC(charbuf, char)
+SL_VEC(strarr, char*)
+
+// append formatted string to buffer (keeping it zero-terminated)
+static void bufprintf(charbuf_t *b, const char *fmt, ...){
+    va_list ap;
+    size_t room = b->cap - b->len;
+    va_start(ap, fmt);
+    int l = vsnprintf(b->data + b->len, room, fmt, ap);
+    va_end(ap);
+    if(l < 0) return;
+    if((size_t)l >= room){
+        charbuf_reserve(b, b->len + l + 1);
+        va_start(ap, fmt);
+        vsnprintf(b->data + b->len, l + 1, fmt, ap);
+        va_end(ap);
     }
-    int r = sl_get_keyval(line, key, value);
-    free(line);
-    return r;
+    b->len += l;
 }
 
 // print option value
-static size_t pr_val(sl_argtype_e type, void *argptr, char **buffer, size_t *buflen, size_t pos){
-    size_t maxlen = *buflen - pos - 1;
-    char *buf = *buffer + pos;
+static void pr_val(sl_argtype_e type, void *argptr, charbuf_t *b){
     switch(type){
         case arg_none:
         case arg_int:
             DBG("int %d", *(int*) argptr);
-            return snprintf(buf, maxlen, "%d", *(int*) argptr);
+            bufprintf(b, "%d", *(int*) argptr);
+        break;
         case arg_longlong:
             DBG("long long %lld", *(long long*) argptr);
-            return snprintf(buf, maxlen, "%lld", *(long long*)argptr);
+            bufprintf(b, "%lld", *(long long*)argptr);
+        break;
         case arg_float:
             DBG("float %g", *(float*) argptr);
-            return snprintf(buf, maxlen, "%g", *(float*) argptr);
+            bufprintf(b, "%g", *(float*) argptr);
+        break;
         case arg_double:
             DBG("double %g", *(double*) argptr);
-            return snprintf(buf, maxlen, "%g", *(double*) argptr);
+            bufprintf(b, "%g", *(double*) argptr);
+        break;
         case arg_string:
             if(!argptr || !(*(char**)argptr)){
-                return snprintf(buf, maxlen, "(null)");
+                bufprintf(b, "(null)");
             }else if(!(**(char**)argptr)){
-                return snprintf(buf, maxlen, "(empty)");
-            }
-            char *str = *(char**) argptr;
-            DBG("string %s", str);
-            size_t z = strlen(str);
-            while(pos + z > *buflen + 5){
-                *buflen += BUFSIZ;
-                *buffer = realloc(*buffer, *buflen);
-                if(!*buffer) ERRX("realloc()");
-                maxlen += BUFSIZ;
-                buf = *buffer + pos;
+                bufprintf(b, "(empty)");
+            }else{
+                DBG("string %s", *(char**) argptr);
+                bufprintf(b, "\"%s\"", *(char**) argptr);
             }
-            return snprintf(buf, maxlen, "\"%s\"", str);
+        break;
         default:
             DBG("function");
-            return snprintf(buf, maxlen, "\"(unsupported)\"");
+            bufprintf(b, "\"(unsupported)\"");
     }
-    return 0;
 }
 
 // print one option
-static size_t print_opt(sl_option_t *opt, char **buffer, size_t *buflen, size_t pos){
-    if((ssize_t)*buflen - pos < 3 *(SL_KEY_LEN + SL_VAL_LEN)){
-        *buflen += BUFSIZ;
-        *buffer = realloc(*buffer, *buflen);
-        if(!*buffer) ERR("realloc()");
-    }
-    char *buf = *buffer + pos;
-    size_t l = 0, maxlen = *buflen - pos - 1;
-    size_t got = snprintf(buf, maxlen, "%s = ", opt->name);
-    l = got; maxlen -= got; buf += got;
+static void print_opt(sl_option_t *opt, charbuf_t *b){
+    bufprintf(b, "%s = ", opt->name);
     if(opt->flag){
         DBG("got flag '%d'", *opt->flag);
-        l += snprintf(buf, maxlen, "%d\n", *opt->flag);
-        return l;
+        bufprintf(b, "%d\n", *opt->flag);
+        return;
     }
     if(!opt->argptr){ // ERR!
-        l += snprintf(buf, maxlen, "\"(no argptr)\"\n");
+        bufprintf(b, "\"(no argptr)\"\n");
         WARNX("Parameter \"%s\" have no argptr!", opt->name);
-        return l;
+        return;
     }
     DBG("type: %d", opt->type);
-    got = pr_val(opt->type, opt->argptr, buffer, buflen, pos + l);
-    l += got; maxlen -= got; buf += got;
-    l += snprintf(buf, maxlen, "\n");
-    return l;
+    pr_val(opt->type, opt->argptr, b);
+    bufprintf(b, "\n");
 }
 
 /**
@@ -190,8 +187,9 @@ static size_t print_opt(sl_option_t *opt, char **buffer, size_t *buflen, size_t
  * @return allocated string (should be free'd)
  */
 char *sl_print_opts(sl_option_t *opt, int showall){
-    char *buf = MALLOC(char, BUFSIZ);
-    size_t L = BUFSIZ, l = 0;
+    charbuf_t buf = {0};
+    charbuf_reserve(&buf, BUFSIZ);
+    *buf.data = 0;
     for(; opt->help; ++opt){
         if(!opt->name) continue; // only show help - not config option!
         DBG("check %s", opt->name);
@@ -210,7 +208,7 @@ char *sl_print_opts(sl_option_t *opt, int showall){
                     tmpopt.argptr = *pp; // string is pointer to pointer!
                 }else tmpopt.argptr = **pp;
                 if(!tmpopt.argptr){ DBG("null"); break; }
-                l += print_opt(&tmpopt, &buf, &L, l);
+                print_opt(&tmpopt, &buf);
                 ++(*pp);
             }
 #endif
@@ -222,12 +220,12 @@ char *sl_print_opts(sl_option_t *opt, int showall){
                     tmpopt.argptr = pp; // string is pointer to pointer!
                 }else tmpopt.argptr = *pp;
                 if(!tmpopt.argptr){ DBG("null"); break; }
-                l += print_opt(&tmpopt, &buf, &L, l);
+                print_opt(&tmpopt, &buf);
                 ++(pp);
             }
-        }else l += print_opt(opt, &buf, &L, l);
+        }else print_opt(opt, &buf);
     }
-    return buf;
+    return buf.data;
 }
 
 
@@ -248,33 +246,32 @@ int sl_conf_readopts(const char *filename, sl_option_t *options){
     int argc = 1;
 #define BUFSZ   (SL_KEY_LEN+SL_VAL_LEN+8)
     char key[SL_KEY_LEN], val[SL_VAL_LEN], obuf[BUFSZ];
-    int argvsize = 0;
-    char **argv = NULL;
+    strarr_t argv = {0};
+    char *line = NULL;
+    size_t linesz = 0;
     do{
-        int r = read_key(f, key, val);
+        int r = read_key(f, &line, &linesz, key, val);
         if(r < 0) break;
         if(r == 0) continue;
         DBG("key='%s', val='%s'", key, (r == 2) ? val : "(absent)");
         ++argc;
-        if(argvsize <= argc){
-            argvsize += 256;
-            argv = realloc(argv, sizeof(char*) * argvsize);
-            if(!argv) ERRX("sl_conf_readopts: realloc() error");
-        }
-        if(argc == 2) argv[0] = strdup(__progname); // all as should be
+        if(argc == 2) strarr_push(&argv, strdup(__progname)); // all as should be
         if(r == 2){
             // remove trailing/ending quotes
             sl_remove_quotes(val);
             snprintf(obuf, BUFSZ-1, "--%s=%s", key, val);
         }else snprintf(obuf, BUFSZ-1, "--%s", key);
         DBG("next argv: '%s'", obuf);
-        argv[argc-1] = strdup(obuf);
+        strarr_push(&argv, strdup(obuf));
     }while(1);
-    if(!argc) return 0;
-    int N = argc; char **a = argv;
+    free(line);
+    fclose(f);
+    if(argc < 2) return 0;
+    strarr_push(&argv, NULL); // argv[argc] should be NULL
+    int N = argc; char **a = argv.data;
     sl_parseargs_hf(&argc, &a, options, sl_conf_showhelp);
-    for(int n = 0; n < N; ++n) free(argv[n]);
-    free(argv);
+    for(int n = 0; n < N; ++n) free(argv.data[n]);
+    strarr_free(&argv);
     return N - argc; // amount of recognized options
 }
 
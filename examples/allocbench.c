@@ -0,0 +1,112 @@
+/*
+ * This file is part of the Snippets project.
+ * Copyright 2026 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <usefull_macros.h>
+
+/*
+ * Allocation of many small objects: sl_alloc/free vs pool vs arena, e.g.
+ *      ./allocbench -s 32 -n 100000 -r 100
+ * Each round allocates `n` objects, touches them and frees them all
+ * (one by one for sl_alloc and pool, by single reset for arena).
+ */
+
+typedef struct{
+    int help;
+    int size;
+    int nobjs;
+    int rounds;
+} parameters;
+
+static parameters G = {
+    .size = 32,
+    .nobjs = 100000,
+    .rounds = 100,
+};
+
+static sl_option_t cmdlnopts[] = {
+    {"help",        NO_ARGS,    NULL,   'h',    arg_int,    APTR(&G.help),      "show this help"},
+    {"size",        NEED_ARG,   NULL,   's',    arg_int,    APTR(&G.size),      "size of each object (default: 32)"},
+    {"nobjs",       NEED_ARG,   NULL,   'n',    arg_int,    APTR(&G.nobjs),     "amount of objects in each round (default: 100000)"},
+    {"rounds",      NEED_ARG,   NULL,   'r',    arg_int,    APTR(&G.rounds),    "amount of rounds (default: 100)"},
+    end_option
+};
+
+static void **objs;
+
+static void show(const char *name, double t){
+    double n = (double)G.nobjs * G.rounds;
+    printf("%-8s %.3fs, %.1f ns/object\n", name, t, t / n * 1e9);
+}
+
+static double run_malloc(){
+    double t0 = sl_dtime();
+    for(int r = 0; r < G.rounds; ++r){
+        for(int i = 0; i < G.nobjs; ++i){
+            objs[i] = MALLOC(uint8_t, G.size);
+            *(uint8_t*)objs[i] = (uint8_t)i;
+        }
+        for(int i = 0; i < G.nobjs; ++i) FREE(objs[i]);
+    }
+    return sl_dtime() - t0;
+}
+
+static double run_pool(){
+    sl_pool_t *p = sl_pool_new(G.size, 0);
+    double t0 = sl_dtime();
+    for(int r = 0; r < G.rounds; ++r){
+        for(int i = 0; i < G.nobjs; ++i){
+            objs[i] = sl_pool_alloc(p);
+            *(uint8_t*)objs[i] = (uint8_t)i;
+        }
+        for(int i = 0; i < G.nobjs; ++i) POOL_FREE(p, objs[i]);
+    }
+    double t = sl_dtime() - t0;
+    sl_pool_delete(&p);
+    return t;
+}
+
+static double run_arena(){
+    sl_arena_t *a = sl_arena_new(0);
+    double t0 = sl_dtime();
+    for(int r = 0; r < G.rounds; ++r){
+        for(int i = 0; i < G.nobjs; ++i){
+            objs[i] = ARENA_ALLOC(a, uint8_t, G.size);
+            *(uint8_t*)objs[i] = (uint8_t)i;
+        }
+        sl_arena_reset(a);
+    }
+    double t = sl_dtime() - t0;
+    sl_arena_delete(&a);
+    return t;
+}
+
+int main(int argc, char **argv){
+    sl_init();
+    sl_parseargs(&argc, &argv, cmdlnopts);
+    if(G.help) sl_showhelp(-1, cmdlnopts);
+    if(G.size < 1 || G.nobjs < 1 || G.rounds < 1) ERRX("Wrong parameters");
+    objs = MALLOC(void*, G.nobjs);
+    green("%d rounds of %d objects by %d bytes\n", G.rounds, G.nobjs, G.size);
+    show("sl_alloc", run_malloc());
+    show("pool", run_pool());
+    show("arena", run_arena());
+    FREE(objs);
+    return 0;
+}
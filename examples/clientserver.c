@@ -16,7 +16,9 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <errno.h>
 #include <inttypes.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdio.h>
 #include <string.h>
@@ -31,6 +33,7 @@ typedef struct{
     int isserver;
     int isunix;
     int maxclients;
+    int epoll;
     char *logfile;
     char *node;
 } parameters;
@@ -47,6 +50,7 @@ static sl_option_t cmdlnopts[] = {
     {"server",      NO_ARGS,    NULL,   's',    arg_int,    APTR(&G.isserver),  "create server"},
     {"unixsock",    NO_ARGS,    NULL,   'u',    arg_int,    APTR(&G.isunix),    "UNIX socket instead of INET"},
     {"maxclients",  NEED_ARG,   NULL,   'm',    arg_int,    APTR(&G.maxclients),"max amount of clients connected to server (default: 2)"},
+    {"epoll",       NO_ARGS,    NULL,   'e',    arg_int,    APTR(&G.epoll),     "use epoll() event loop in server"},
     end_option
 };
 
@@ -78,16 +82,27 @@ static void runclient(sl_sock_t *s){
             printf("server > %s\n", rbuf);
         }
         printf("send > "); fflush(stdout);
-        int c, k = 0;
+        int c = 0, k = 0;
+        // sleep until user types something or server sends a line
+        struct pollfd fds[2] = {{.fd = STDIN_FILENO, .events = POLLIN}, {.fd = sl_sock_linefd(s), .events = POLLIN}};
         while (k < BUFSIZ-1){
-            ssize_t got = sl_sock_readline(s, rbuf, BUFSIZ);
-            if(got > 0){
-                DBG("GOT %zd", got);
-                if(k == 0){ printf("\nserver > %s\nsend > ", rbuf); fflush(stdout); }// user didn't type anything -> show server messages
-                else sl_RB_writestr(rb, rbuf);
-            } else if(got < 0){ DBG("disc"); signals(0);}
-            if(!s || !s->connected){ DBG("DISC"); signals(0); }
-            c = sl_read_con();
+            if(poll(fds, 2, -1) < 0){
+                if(errno == EINTR) continue;
+                WARN("poll()");
+                signals(0);
+            }
+            if(fds[1].revents){
+                ssize_t got;
+                while((got = sl_sock_readline(s, rbuf, BUFSIZ)) > 0){
+                    DBG("GOT %zd", got);
+                    if(k == 0){ printf("\nserver > %s\nsend > ", rbuf); fflush(stdout); }// user didn't type anything -> show server messages
+                    else sl_RB_writestr(rb, rbuf);
+                }
+                if(got < 0){ DBG("disc"); signals(0);}
+                if(!s || !s->connected){ DBG("DISC"); signals(0); }
+            }
+            if(!fds[0].revents) continue;
+            c = getchar();
             if(!c) continue;
             if(c == '\b' || c == 127){ // use DEL and BACKSPACE to erase previous symbol
                 if(k){
@@ -224,7 +239,8 @@ int main(int argc, char **argv){
     sl_socktype_e type = (G.isunix) ? SOCKT_UNIX : SOCKT_NET;
     if(G.isserver){
         //sl_sock_keyno_init(&kph_number); // don't forget to init first or use macro in initialisation
-        s = sl_sock_run_server(type, G.node, -1, handlers);
+        sl_sock_srvopts_t opts = {.maxclients = G.maxclients, .evmode = G.epoll ? SOCKEV_EPOLL : SOCKEV_POLL};
+        s = sl_sock_run_server_ext(type, G.node, -1, handlers, &opts);
         DBG("Server started");
     } else {
         sl_setup_con();
@@ -233,7 +249,6 @@ int main(int argc, char **argv){
     }
     if(!s) ERRX("Can't create socket and/or run threads");
     if(G.isserver){
-        sl_sock_changemaxclients(s, G.maxclients);
         sl_sock_maxclhandler(s, toomuch);
         sl_sock_connhandler(s, connected);
         sl_sock_dischandler(s, disconnected);
@@ -251,17 +266,16 @@ int main(int argc, char **argv){
     if(G.isserver){
         //double t0 = sl_dtime();
         while(s && s->connected){
-            if(!s->rthread){
-                WARNX("Server handlers thread is dead");
-                LOGERR("Server handlers thread is dead");
-                break;
-            }
             /*double tn = sl_dtime();
             if(tn - t0 > 10.){
                 sl_sock_sendall((uint8_t*)"PING\n", 5);
                 t0 = tn;
             }*/
         }
+        if(s){ // server's thread clears `connected` when dies
+            WARNX("Server handlers thread is dead");
+            LOGERR("Server handlers thread is dead");
+        }
     }else runclient(s);
     LOGMSG("Ended");
     DBG("Close");
@@ -0,0 +1,137 @@
+/*
+ * This file is part of the Snippets project.
+ * Copyright 2026 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <usefull_macros.h>
+
+/*
+ * Lookup of string and integer keys: linear scan vs hash map vs binary search, e.g.
+ *      ./hmapbench -n 16; ./hmapbench -n 1000
+ * Keys are like socket handlers' names ("key123"), half of lookups miss.
+ */
+
+typedef struct{
+    int help;
+    int nkeys;
+    int nlookups;
+} parameters;
+
+static parameters G = {
+    .nkeys = 32,
+    .nlookups = 1000000,
+};
+
+static sl_option_t cmdlnopts[] = {
+    {"help",        NO_ARGS,    NULL,   'h',    arg_int,    APTR(&G.help),      "show this help"},
+    {"nkeys",       NEED_ARG,   NULL,   'n',    arg_int,    APTR(&G.nkeys),     "amount of keys (default: 32)"},
+    {"nlookups",    NEED_ARG,   NULL,   'm',    arg_int,    APTR(&G.nlookups),  "amount of lookups (default: 1000000)"},
+    end_option
+};
+
+SL_BSEARCH(i64, int64_t, SL_LESS)
+
+static char **keys, **queries;
+static int64_t *ikeys, *iqueries;
+
+static void show(const char *name, double t, int found){
+    if(found != G.nlookups / 2) ERRX("%s: found %d instead of %d", name, found, G.nlookups / 2);
+    printf("%-12s %.3fs, %.1f ns/lookup\n", name, t, t / G.nlookups * 1e9);
+}
+
+static void run_strings(){
+    int found = 0;
+    double t0 = sl_dtime();
+    for(int q = 0; q < G.nlookups; ++q){
+        for(int i = 0; i < G.nkeys; ++i)
+            if(0 == strcmp(keys[i], queries[q])){ ++found; break; }
+    }
+    show("str linear", sl_dtime() - t0, found);
+    sl_hmap_t *m = sl_hmap_new(SL_HMAP_STRKEYS, G.nkeys);
+    for(int i = 0; i < G.nkeys; ++i) sl_hmap_put(m, keys[i], keys[i]);
+    found = 0;
+    t0 = sl_dtime();
+    for(int q = 0; q < G.nlookups; ++q)
+        if(sl_hmap_get(m, queries[q])) ++found;
+    show("str hmap", sl_dtime() - t0, found);
+    sl_hmap_delete(&m);
+    sl_sortidx_t *x = sl_sortidx_new(keys, G.nkeys, sizeof(char*), 0);
+    found = 0;
+    t0 = sl_dtime();
+    for(int q = 0; q < G.nlookups; ++q)
+        if(sl_sortidx_find(x, queries[q]) > -1) ++found;
+    show("str sortidx", sl_dtime() - t0, found);
+    sl_sortidx_delete(&x);
+}
+
+static void run_ints(){
+    int found = 0;
+    double t0 = sl_dtime();
+    for(int q = 0; q < G.nlookups; ++q){
+        for(int i = 0; i < G.nkeys; ++i)
+            if(ikeys[i] == iqueries[q]){ ++found; break; }
+    }
+    show("int linear", sl_dtime() - t0, found);
+    sl_hmap_t *m = sl_hmap_new(SL_HMAP_INTKEYS, G.nkeys);
+    for(int i = 0; i < G.nkeys; ++i) sl_hmap_puti(m, ikeys[i], &ikeys[i]);
+    found = 0;
+    t0 = sl_dtime();
+    for(int q = 0; q < G.nlookups; ++q)
+        if(sl_hmap_geti(m, iqueries[q], NULL)) ++found;
+    show("int hmap", sl_dtime() - t0, found);
+    sl_hmap_delete(&m);
+    found = 0; // ikeys are sorted
+    t0 = sl_dtime();
+    for(int q = 0; q < G.nlookups; ++q){
+        size_t i = i64_lower(ikeys, G.nkeys, iqueries[q]);
+        if(i < (size_t)G.nkeys && ikeys[i] == iqueries[q]) ++found;
+    }
+    show("int bsearch", sl_dtime() - t0, found);
+}
+
+int main(int argc, char **argv){
+    sl_init();
+    sl_parseargs(&argc, &argv, cmdlnopts);
+    if(G.help) sl_showhelp(-1, cmdlnopts);
+    if(G.nkeys < 1 || G.nlookups < 2) ERRX("Wrong parameters");
+    G.nlookups &= ~1;
+    keys = MALLOC(char*, G.nkeys);
+    ikeys = MALLOC(int64_t, G.nkeys);
+    char buf[32];
+    for(int i = 0; i < G.nkeys; ++i){
+        snprintf(buf, 32, "key%d", i * 2);
+        keys[i] = strdup(buf);
+        ikeys[i] = i * 2;
+    }
+    // even queries hit, odd ones miss
+    queries = MALLOC(char*, G.nlookups);
+    iqueries = MALLOC(int64_t, G.nlookups);
+    for(int q = 0; q < G.nlookups; ++q){
+        int k = (q & 1) ? 2 * (q % G.nkeys) + 1 : 2 * (q % G.nkeys);
+        snprintf(buf, 32, "key%d", k);
+        queries[q] = strdup(buf);
+        iqueries[q] = k;
+    }
+    green("%d keys, %d lookups\n", G.nkeys, G.nlookups);
+    run_strings();
+    run_ints();
+    for(int i = 0; i < G.nkeys; ++i) FREE(keys[i]);
+    for(int q = 0; q < G.nlookups; ++q) FREE(queries[q]);
+    FREE(keys); FREE(ikeys); FREE(queries); FREE(iqueries);
+    return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ * This file is part of the Snippets project.
+ * Copyright 2026 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <usefull_macros.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <usefull_macros.h>
+
+/*
+ * Scanning text file by lines: getline() vs mmap'ed file iterator, e.g.
+ *      ./linebench -s 512; ./linebench -f /var/log/syslog
+ * Without `-f` temporary file with `-s` megabytes of random lines is created.
+ */
+
+typedef struct{
+    int help;
+    int size;
+    char *file;
+} parameters;
+
+static parameters G = {
+    .size = 256,
+};
+
+static sl_option_t cmdlnopts[] = {
+    {"help",        NO_ARGS,    NULL,   'h',    arg_int,    APTR(&G.help),      "show this help"},
+    {"size",        NEED_ARG,   NULL,   's',    arg_int,    APTR(&G.size),      "size of temporary file, MB (default: 256)"},
+    {"file",        NEED_ARG,   NULL,   'f',    arg_string, APTR(&G.file),      "file to scan"},
+    end_option
+};
+
+static char tmpname[] = "/tmp/linebenchXXXXXX";
+
+// create file with lines of 1..160 printable symbols
+static void mkfile(){
+    int fd = mkstemp(tmpname);
+    if(fd < 0) ERR("mkstemp()");
+    FILE *f = fdopen(fd, "w");
+    if(!f) ERR("fdopen()");
+    size_t total = (size_t)G.size << 20, written = 0;
+    char buf[162];
+    srand(1);
+    while(written < total){
+        int l = 1 + rand() % 160;
+        for(int i = 0; i < l; ++i) buf[i] = ' ' + rand() % 95;
+        buf[l++] = '\n';
+        fwrite(buf, 1, l, f);
+        written += l;
+    }
+    fclose(f);
+    G.file = tmpname;
+}
+
+static void show(const char *name, double t, size_t nlines, size_t nbytes){
+    printf("%-8s %.3fs, %zd lines, %.1f ns/line, %.0f MB/s\n", name, t, nlines, t / nlines * 1e9, nbytes / t / 1048576.);
+}
+
+int main(int argc, char **argv){
+    sl_init();
+    sl_parseargs(&argc, &argv, cmdlnopts);
+    if(G.help) sl_showhelp(-1, cmdlnopts);
+    if(!G.file){
+        if(G.size < 1) ERRX("Wrong parameters");
+        mkfile();
+    }
+    // the first pass reads file into page cache, so both methods work with warm cache
+    size_t nlines[2] = {0}, nbytes[2] = {0};
+    for(int pass = 0; pass < 2; ++pass){
+        FILE *f = fopen(G.file, "r");
+        if(!f) ERR("fopen()");
+        char *line = NULL;
+        size_t n = 0;
+        ssize_t got;
+        nlines[0] = nbytes[0] = 0;
+        double t0 = sl_dtime();
+        while((got = getline(&line, &n, f)) > 0){
+            ++nlines[0];
+            nbytes[0] += got;
+        }
+        double t = sl_dtime() - t0;
+        free(line);
+        fclose(f);
+        if(pass) show("getline", t, nlines[0], nbytes[0]);
+    }
+    sl_mmapiter_t *it = sl_mmap_iter(G.file, '\n');
+    if(!it) ERRX("Can't map %s", G.file);
+    const char *rec;
+    size_t len;
+    double t0 = sl_dtime();
+    while(sl_mmap_next(it, &rec, &len)){
+        ++nlines[1];
+        nbytes[1] += len;
+    }
+    double t = sl_dtime() - t0;
+    nbytes[1] = it->pos; // with delimiters
+    show("mmap", t, nlines[1], nbytes[1]);
+    sl_mmap_iterfree(&it);
+    if(nlines[0] != nlines[1] || nbytes[0] != nbytes[1])
+        ERRX("Different results: %zd/%zd lines, %zd/%zd bytes", nlines[0], nlines[1], nbytes[0], nbytes[1]);
+    if(G.file == tmpname) unlink(tmpname);
+    return 0;
+}
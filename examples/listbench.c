@@ -0,0 +1,110 @@
+/*
+ * This file is part of the Snippets project.
+ * Copyright 2026 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <usefull_macros.h>
+
+/*
+ * FIFO of many items: allocated nodes vs pooled list vs intrusive list, e.g.
+ *      ./listbench -n 1000000 -r 10
+ */
+
+typedef struct{
+    int help;
+    int nitems;
+    int rounds;
+} parameters;
+
+static parameters G = {
+    .nitems = 1000000,
+    .rounds = 10,
+};
+
+static sl_option_t cmdlnopts[] = {
+    {"help",        NO_ARGS,    NULL,   'h',    arg_int,    APTR(&G.help),      "show this help"},
+    {"nitems",      NEED_ARG,   NULL,   'n',    arg_int,    APTR(&G.nitems),    "amount of items in list (default: 1000000)"},
+    {"rounds",      NEED_ARG,   NULL,   'r',    arg_int,    APTR(&G.rounds),    "amount of rounds (default: 10)"},
+    end_option
+};
+
+// user's item with embedded node for intrusive list
+typedef struct{
+    int value;
+    sl_list_t node;
+} item_t;
+
+static item_t *items;
+
+static void show(const char *name, double t, long long sum){
+    double n = (double)G.nitems * G.rounds;
+    long long good = (long long)G.nitems * (G.nitems - 1) / 2 * G.rounds;
+    if(sum != good) ERRX("%s: wrong sum %lld instead of %lld", name, sum, good);
+    printf("%-10s %.3fs, %.1f ns/item\n", name, t, t / n * 1e9);
+}
+
+static void run_list(){
+    sl_list_t *l = NULL;
+    long long sum = 0;
+    double t0 = sl_dtime();
+    for(int r = 0; r < G.rounds; ++r){
+        for(int i = 0; i < G.nitems; ++i) sl_list_push_tail(&l, &items[i]);
+        item_t *it;
+        while((it = sl_list_pop(&l))) sum += it->value;
+    }
+    show("sl_list", sl_dtime() - t0, sum);
+}
+
+static void run_plist(){
+    sl_plist_t *l = sl_plist_new(4096);
+    long long sum = 0;
+    double t0 = sl_dtime();
+    for(int r = 0; r < G.rounds; ++r){
+        for(int i = 0; i < G.nitems; ++i) sl_plist_push_tail(l, &items[i]);
+        item_t *it;
+        while((it = sl_plist_pop(l))) sum += it->value;
+    }
+    show("sl_plist", sl_dtime() - t0, sum);
+    sl_plist_delete(&l);
+}
+
+static void run_ilist(){
+    sl_list_t *l = NULL;
+    long long sum = 0;
+    double t0 = sl_dtime();
+    for(int r = 0; r < G.rounds; ++r){
+        for(int i = 0; i < G.nitems; ++i) sl_ilist_push_tail(&l, &items[i].node);
+        sl_list_t *n;
+        while((n = sl_ilist_pop(&l))) sum += SL_CONTAINER_OF(n, item_t, node)->value;
+    }
+    show("sl_ilist", sl_dtime() - t0, sum);
+}
+
+int main(int argc, char **argv){
+    sl_init();
+    sl_parseargs(&argc, &argv, cmdlnopts);
+    if(G.help) sl_showhelp(-1, cmdlnopts);
+    if(G.nitems < 1 || G.rounds < 1) ERRX("Wrong parameters");
+    items = MALLOC(item_t, G.nitems);
+    for(int i = 0; i < G.nitems; ++i) items[i].value = i;
+    green("%d rounds of %d items pushed to FIFO and popped\n", G.rounds, G.nitems);
+    run_list();
+    run_plist();
+    run_ilist();
+    FREE(items);
+    return 0;
+}
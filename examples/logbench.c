@@ -0,0 +1,123 @@
+/*
+ * This file is part of the Snippets project.
+ * Copyright 2026 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <usefull_macros.h>
+
+/*
+ * Cost of sl_putlogt() for synchronous and asynchronous logs, e.g.
+ *      ./logbench -l /tmp/bench.log -t 4 -n 100000
+ *      ./logbench -b -t 4 -n 100000; ./logdecode /tmp/logbench.log | tail
+ */
+
+typedef struct{
+    int help;
+    char *logpath;
+    int nthreads;
+    int nrecords;
+    int qsize;
+    int usec;
+    int binary;
+} parameters;
+
+static parameters G = {
+    .logpath = "/tmp/logbench.log",
+    .nthreads = 1,
+    .nrecords = 100000,
+};
+
+static sl_option_t cmdlnopts[] = {
+    {"help",        NO_ARGS,    NULL,   'h',    arg_int,    APTR(&G.help),      "show this help"},
+    {"logfile",     NEED_ARG,   NULL,   'l',    arg_string, APTR(&G.logpath),   "log file (default: /tmp/logbench.log), will be truncated"},
+    {"threads",     NEED_ARG,   NULL,   't',    arg_int,    APTR(&G.nthreads),  "amount of writing threads (default: 1)"},
+    {"records",     NEED_ARG,   NULL,   'n',    arg_int,    APTR(&G.nrecords),  "amount of records by each thread (default: 100000)"},
+    {"qsize",       NEED_ARG,   NULL,   'q',    arg_int,    APTR(&G.qsize),     "size of asynchronous queue of each thread (default: 65536)"},
+    {"usec",        NO_ARGS,    NULL,   'u',    arg_int,    APTR(&G.usec),      "add microseconds to timestamps"},
+    {"binary",      NO_ARGS,    NULL,   'b',    arg_int,    APTR(&G.binary),    "write binary logs (decode them with logdecode)"},
+    end_option
+};
+
+static sl_log_t *L = NULL;
+
+static void *writer(void *d){
+    long n = (long)d;
+    for(int i = 0; i < G.nrecords; ++i)
+        sl_putlogt(1, L, LOGLEVEL_DBG, "thread %ld, record %d: some debugging value = %g", n, i, i * 0.5);
+    return NULL;
+}
+
+// write records by all threads and return time spent
+static double run(){
+    pthread_t *thr = MALLOC(pthread_t, G.nthreads);
+    double t0 = sl_dtime();
+    for(long i = 0; i < G.nthreads; ++i)
+        if(pthread_create(&thr[i], NULL, writer, (void*)i)) ERR("pthread_create()");
+    for(int i = 0; i < G.nthreads; ++i) pthread_join(thr[i], NULL);
+    double t = sl_dtime() - t0;
+    FREE(thr);
+    return t;
+}
+
+// amount of lines in log file
+static size_t nlines(){
+    if(G.binary){
+        FILE *null = fopen("/dev/null", "w");
+        if(!null) ERR("fopen()");
+        ssize_t n = sl_decodelog(G.logpath, null);
+        fclose(null);
+        return (n < 0) ? 0 : (size_t)n;
+    }
+    FILE *f = fopen(G.logpath, "r");
+    if(!f) ERR("fopen()");
+    size_t n = 0;
+    int c;
+    while(EOF != (c = fgetc(f))) if(c == '\n') ++n;
+    fclose(f);
+    return n;
+}
+
+int main(int argc, char **argv){
+    sl_init();
+    sl_parseargs(&argc, &argv, cmdlnopts);
+    if(G.help) sl_showhelp(-1, cmdlnopts);
+    if(G.nthreads < 1 || G.nrecords < 1 || G.qsize < 0) ERRX("Wrong parameters");
+    size_t total = (size_t)G.nthreads * G.nrecords;
+    green("%d threads write %d records each\n", G.nthreads, G.nrecords);
+    if(truncate(G.logpath, 0) && errno != ENOENT) ERR("truncate()");
+    sl_logopts_t opts = {.usec = G.usec, .binary = G.binary};
+    L = sl_createlog_ext(G.logpath, LOGLEVEL_ANY, 1, &opts);
+    if(!L) ERRX("Can't create log");
+    double t = run();
+    sl_deletelog(&L);
+    printf("sync:  %.3fs, %.2f us/record, %zd lines in file\n", t, t * 1e6 / total, nlines());
+    if(truncate(G.logpath, 0)) ERR("truncate()");
+    opts.async = 1;
+    opts.queuesize = G.qsize;
+    L = sl_createlog_ext(G.logpath, LOGLEVEL_ANY, 1, &opts);
+    if(!L) ERRX("Can't create log");
+    t = run();
+    size_t dropped = sl_log_dropped(L);
+    double t0 = sl_dtime();
+    sl_deletelog(&L);
+    t0 = sl_dtime() - t0;
+    printf("async: %.3fs, %.2f us/record (+%.3fs to flush), %zd dropped, %zd lines in file\n",
+           t, t * 1e6 / total, t0, dropped, nlines());
+    return 0;
+}
@@ -0,0 +1,61 @@
+/*
+ * This file is part of the Snippets project.
+ * Copyright 2026 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <usefull_macros.h>
+
+/*
+ * Convert binary logs (sl_logopts_t.binary) into text, e.g.
+ *      ./logdecode /tmp/logbench.log | less
+ *      ./logdecode -o text.log binary.log
+ */
+
+typedef struct{
+    int help;
+    char *outfile;
+} parameters;
+
+static parameters G = {0};
+
+static sl_option_t cmdlnopts[] = {
+    {"help",        NO_ARGS,    NULL,   'h',    arg_int,    APTR(&G.help),      "show this help"},
+    {"output",      NEED_ARG,   NULL,   'o',    arg_string, APTR(&G.outfile),   "output file (default: stdout)"},
+    end_option
+};
+
+int main(int argc, char **argv){
+    sl_init();
+    sl_helpstring("Usage: %s [args] binary logs\n\n\tWhere args are:\n");
+    sl_parseargs(&argc, &argv, cmdlnopts);
+    if(G.help || argc < 1) sl_showhelp(-1, cmdlnopts);
+    FILE *out = stdout;
+    if(G.outfile){
+        out = fopen(G.outfile, "w");
+        if(!out) ERR("Can't open %s", G.outfile);
+    }
+    int ret = 0;
+    for(int i = 0; i < argc; ++i){
+        ssize_t n = sl_decodelog(argv[i], out);
+        if(n < 0){
+            WARNX("%s isn't a binary log", argv[i]);
+            ret = 1;
+        }else if(G.outfile) green("%s: %zd records\n", argv[i], n);
+    }
+    if(out != stdout) fclose(out);
+    return ret;
+}
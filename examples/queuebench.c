@@ -0,0 +1,144 @@
+/*
+ * This file is part of the Snippets project.
+ * Copyright 2026 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <usefull_macros.h>
+
+/*
+ * Passing items between threads: sl_list_t with mutex and condition variable vs
+ * lock-free MPMC and MPSC queues with blocking waits, e.g.
+ *      ./queuebench -p 4 -c 4 -n 1000000; ./queuebench -p 4 -c 1
+ */
+
+typedef struct{
+    int help;
+    int nprod;
+    int ncons;
+    int nitems;
+    int size;
+} parameters;
+
+static parameters G = {
+    .nprod = 2,
+    .ncons = 2,
+    .nitems = 1000000,
+    .size = 1024,
+};
+
+static sl_option_t cmdlnopts[] = {
+    {"help",        NO_ARGS,    NULL,   'h',    arg_int,    APTR(&G.help),      "show this help"},
+    {"producers",   NEED_ARG,   NULL,   'p',    arg_int,    APTR(&G.nprod),     "amount of producer threads (default: 2)"},
+    {"consumers",   NEED_ARG,   NULL,   'c',    arg_int,    APTR(&G.ncons),     "amount of consumer threads (default: 2)"},
+    {"nitems",      NEED_ARG,   NULL,   'n',    arg_int,    APTR(&G.nitems),    "amount of items from each producer (default: 1000000)"},
+    {"size",        NEED_ARG,   NULL,   's',    arg_int,    APTR(&G.size),      "size of MPMC queue (default: 1024)"},
+    end_option
+};
+
+// queue operations under test
+typedef struct{
+    const char *name;
+    void (*push)(void *data);
+    void *(*pop)();
+} qops_t;
+
+static int stopmark; // consumers stop after popping its address
+
+// sl_list_t + mutex
+static sl_list_t *list = NULL;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static void list_push(void *data){
+    pthread_mutex_lock(&mutex);
+    sl_list_push_tail(&list, data);
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&mutex);
+}
+static void *list_pop(){
+    pthread_mutex_lock(&mutex);
+    while(!list) pthread_cond_wait(&cond, &mutex);
+    void *d = sl_list_pop(&list);
+    pthread_mutex_unlock(&mutex);
+    return d;
+}
+
+static sl_mpmc_t *mpmc = NULL;
+static void mpmc_push(void *data){ sl_mpmc_push_wait(mpmc, data, -1.); }
+static void *mpmc_pop(){ return sl_mpmc_pop_wait(mpmc, -1.); }
+
+static sl_mpsc_t *mpsc = NULL;
+static void mpsc_push(void *data){ sl_mpsc_push(mpsc, data); }
+static void *mpsc_pop(){ return sl_mpsc_pop_wait(mpsc, -1.); }
+
+static const qops_t *ops;
+
+static void *producer(void _U_ *d){
+    for(uintptr_t i = 1; i <= (uintptr_t)G.nitems; ++i) ops->push((void*)i);
+    return NULL;
+}
+
+static void *consumer(void *d){
+    unsigned long long sum = 0;
+    for(;;){
+        void *x = ops->pop();
+        if(x == &stopmark) break;
+        sum += (uintptr_t)x;
+    }
+    *(unsigned long long*)d = sum;
+    return NULL;
+}
+
+static void run(const qops_t *q){
+    ops = q;
+    pthread_t *prod = MALLOC(pthread_t, G.nprod), *cons = MALLOC(pthread_t, G.ncons);
+    unsigned long long *sums = MALLOC(unsigned long long, G.ncons), sum = 0;
+    double t0 = sl_dtime();
+    for(int i = 0; i < G.ncons; ++i) if(pthread_create(&cons[i], NULL, consumer, &sums[i])) ERR("pthread_create()");
+    for(int i = 0; i < G.nprod; ++i) if(pthread_create(&prod[i], NULL, producer, NULL)) ERR("pthread_create()");
+    for(int i = 0; i < G.nprod; ++i) pthread_join(prod[i], NULL);
+    for(int i = 0; i < G.ncons; ++i) q->push(&stopmark);
+    for(int i = 0; i < G.ncons; ++i){
+        pthread_join(cons[i], NULL);
+        sum += sums[i];
+    }
+    double t = sl_dtime() - t0;
+    unsigned long long good = (unsigned long long)G.nitems * (G.nitems + 1) / 2 * G.nprod;
+    if(sum != good) ERRX("%s: wrong sum %llu instead of %llu", q->name, sum, good);
+    double n = (double)G.nitems * G.nprod;
+    printf("%-6s %.3fs, %.1f ns/item, %.2f Mitems/s\n", q->name, t, t / n * 1e9, n / t / 1e6);
+    FREE(prod); FREE(cons); FREE(sums);
+}
+
+int main(int argc, char **argv){
+    sl_init();
+    sl_parseargs(&argc, &argv, cmdlnopts);
+    if(G.help) sl_showhelp(-1, cmdlnopts);
+    if(G.nprod < 1 || G.ncons < 1 || G.nitems < 1 || G.size < 2) ERRX("Wrong parameters");
+    green("%d producers, %d consumers, %d items from each producer\n", G.nprod, G.ncons, G.nitems);
+    qops_t qlist = {"mutex", list_push, list_pop}, qmpmc = {"MPMC", mpmc_push, mpmc_pop}, qmpsc = {"MPSC", mpsc_push, mpsc_pop};
+    run(&qlist);
+    mpmc = sl_mpmc_new(G.size);
+    run(&qmpmc);
+    sl_mpmc_delete(&mpmc);
+    if(G.ncons == 1){
+        mpsc = sl_mpsc_new();
+        run(&qmpsc);
+        sl_mpsc_delete(&mpsc);
+    }else printf("MPSC   skipped (needs one consumer)\n");
+    return 0;
+}
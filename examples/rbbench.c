@@ -0,0 +1,113 @@
+/*
+ * This file is part of the Snippets project.
+ * Copyright 2026 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <usefull_macros.h>
+
+/*
+ * Throughput of ring buffer with one producer and one consumer thread:
+ * mutex-protected buffer vs lock-free SPSC, e.g.
+ *      ./rbbench -s 4096 -l 64; ./rbbench -s 4096 -l 64 -M
+ */
+
+typedef struct{
+    int help;
+    int size;
+    int linelen;
+    int nmbytes;
+    int mirror;
+} parameters;
+
+static parameters G = {
+    .size = 65536,
+    .linelen = 64,
+    .nmbytes = 256,
+};
+
+static sl_option_t cmdlnopts[] = {
+    {"help",        NO_ARGS,    NULL,   'h',    arg_int,    APTR(&G.help),      "show this help"},
+    {"bufsize",     NEED_ARG,   NULL,   's',    arg_int,    APTR(&G.size),      "size of ring buffer (default: 65536)"},
+    {"linelen",     NEED_ARG,   NULL,   'l',    arg_int,    APTR(&G.linelen),   "length of each line including '\\n' (default: 64)"},
+    {"mbytes",      NEED_ARG,   NULL,   'm',    arg_int,    APTR(&G.nmbytes),   "amount of data to transfer, megabytes (default: 256)"},
+    {"mirror",      NO_ARGS,    NULL,   'M',    arg_int,    APTR(&G.mirror),    "use mirrored memory buffers"},
+    end_option
+};
+
+static size_t nlines;
+
+// write `nlines` lines by portions of up to 16 lines
+static void *producer(void *d){
+    sl_ringbuffer_t *b = (sl_ringbuffer_t*)d;
+    size_t portion = 16 * G.linelen;
+    uint8_t *buf = MALLOC(uint8_t, portion);
+    for(size_t i = 0; i < portion; ++i) buf[i] = ((i + 1) % G.linelen) ? 'a' + i % 26 : '\n';
+    size_t total = nlines * G.linelen, sent = 0, off = 0;
+    while(sent < total){
+        size_t len = portion - off;
+        if(len > total - sent) len = total - sent;
+        size_t w = sl_RB_write(b, buf + off, len);
+        if(!w){ sched_yield(); continue; }
+        sent += w;
+        off = (off + w) % portion;
+    }
+    FREE(buf);
+    return NULL;
+}
+
+// read all lines and return time spent
+static double run(sl_ringbuffer_t *b){
+    char *line = MALLOC(char, G.linelen + 1);
+    pthread_t thr;
+    double t0 = sl_dtime();
+    if(pthread_create(&thr, NULL, producer, b)) ERR("pthread_create()");
+    for(size_t got = 0; got < nlines;){
+        ssize_t r = sl_RB_readline(b, line, G.linelen + 1);
+        if(r < 0) ERRX("Line too long");
+        if(r == 0){ sched_yield(); continue; }
+        if(r != G.linelen) ERRX("Wrong line length: %zd", r);
+        ++got;
+    }
+    pthread_join(thr, NULL);
+    double t = sl_dtime() - t0;
+    FREE(line);
+    return t;
+}
+
+int main(int argc, char **argv){
+    sl_init();
+    sl_parseargs(&argc, &argv, cmdlnopts);
+    if(G.help) sl_showhelp(-1, cmdlnopts);
+    if(G.linelen < 2 || G.size <= G.linelen || G.nmbytes < 1) ERRX("Wrong parameters");
+    nlines = (size_t)G.nmbytes * 1024 * 1024 / G.linelen;
+    double mb = (double)nlines * G.linelen / 1024. / 1024.;
+    green("Ring buffer of %d bytes, %zd lines of %d bytes\n", G.size, nlines, G.linelen);
+    int flags = G.mirror ? SL_RB_MIRROR : 0;
+    sl_ringbuffer_t *b = sl_RB_new_ext(G.size, flags);
+    if(G.mirror && !b->mirrored) ERRX("Can't create mirrored buffer");
+    double t = run(b);
+    printf("mutex: %.3fs, %.1f MB/s, %.1f Mlines/s\n", t, mb / t, nlines / t / 1e6);
+    sl_RB_delete(&b);
+    b = sl_RB_new_ext(G.size, flags | SL_RB_SPSC);
+    t = run(b);
+    printf("SPSC:  %.3fs, %.1f MB/s, %.1f Mlines/s\n", t, mb / t, nlines / t / 1e6);
+    sl_RB_delete(&b);
+    return 0;
+}
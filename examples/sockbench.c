@@ -0,0 +1,350 @@
+/*
+ * This file is part of the Snippets project.
+ * Copyright 2026 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <usefull_macros.h>
+
+/*
+ * Benchmark of server's event loops: idle CPU usage and request-response latency
+ * for given amount of simultaneously connected clients, e.g.
+ *      for N in 32 1000 10000; do ./sockbench -n $N; ./sockbench -n $N -e; done
+ * and throughput of workers' pool with slow handlers, e.g.
+ *      for W in 1 4; do ./sockbench -n 64 -j 64 -d 100 -w $W -p 12345; done
+ * and broadcasting by sl_sock_sendall, e.g.
+ *      ./sockbench -n 100 -b 64 -e
+ * and latency of library client (sl_sock_run_client + sl_sock_waitline), e.g.
+ *      ./sockbench -n 1 -c
+ * and HTTP requests with new connection for each of them vs keep-alive connection, e.g.
+ *      ./sockbench -n 1 -H -p 12345
+ */
+
+typedef struct{
+    int help;
+    int epoll;
+    int nclients;
+    int nmessages;
+    int nworkers;
+    int nthreads;
+    int delay;
+    int bcastlen;
+    int libclient;
+    int http;
+    char *port;
+    double idletime;
+} parameters;
+
+static parameters G = {
+    .nclients = 32,
+    .nmessages = 10000,
+    .nworkers = 1,
+    .idletime = 2.,
+};
+
+static sl_option_t cmdlnopts[] = {
+    {"help",        NO_ARGS,    NULL,   'h',    arg_int,    APTR(&G.help),      "show this help"},
+    {"epoll",       NO_ARGS,    NULL,   'e',    arg_int,    APTR(&G.epoll),     "use epoll() event loop instead of poll()"},
+    {"nclients",    NEED_ARG,   NULL,   'n',    arg_int,    APTR(&G.nclients),  "amount of clients connected (default: 32)"},
+    {"nmessages",   NEED_ARG,   NULL,   'm',    arg_int,    APTR(&G.nmessages), "amount of request-response messages (default: 10000)"},
+    {"idletime",    NEED_ARG,   NULL,   't',    arg_double, APTR(&G.idletime),  "time of idle CPU usage measurement, seconds (default: 2)"},
+    {"workers",     NEED_ARG,   NULL,   'w',    arg_int,    APTR(&G.nworkers),  "amount of server's workers (default: 1, <0 - THREAD_NUMBER), >1 means epoll()"},
+    {"threads",     NEED_ARG,   NULL,   'j',    arg_int,    APTR(&G.nthreads),  "measure throughput with this amount of client threads"},
+    {"delay",       NEED_ARG,   NULL,   'd',    arg_int,    APTR(&G.delay),     "handler's processing time, us (default: 0)"},
+    {"port",        NEED_ARG,   NULL,   'p',    arg_string, APTR(&G.port),      "use INET socket on localhost:port instead of UNIX"},
+    {"broadcast",   NEED_ARG,   NULL,   'b',    arg_int,    APTR(&G.bcastlen),  "measure broadcasting of messages with given length to all clients"},
+    {"client",      NO_ARGS,    NULL,   'c',    arg_int,    APTR(&G.libclient), "measure latency of sl_sock_run_client() instead of raw socket"},
+    {"http",        NO_ARGS,    NULL,   'H',    arg_int,    APTR(&G.http),      "measure HTTP requests: new connection for each vs keep-alive"},
+    end_option
+};
+
+// integer handler with given processing time
+static sl_sock_hresult_e delayhandler(sl_sock_t *client, sl_sock_hitem_t *item, const char *val){
+    if(G.delay > 0) usleep(G.delay);
+    return sl_sock_inthandler(client, item, val);
+}
+
+static sl_sock_int_t ival = {0};
+static sl_sock_hitem_t handlers[] = {
+    {delayhandler, "int", "set/get integer value", (void*)&ival},
+    {NULL, NULL, NULL, NULL}
+};
+
+// process CPU time (all threads), seconds
+static double cputime(){
+    struct rusage u;
+    getrusage(RUSAGE_SELF, &u);
+    return u.ru_utime.tv_sec + u.ru_stime.tv_sec + (u.ru_utime.tv_usec + u.ru_stime.tv_usec) / 1e6;
+}
+
+// send request and wait for full answer
+static int request(int fd, char *buf, size_t len){
+    static const char req[] = "int\n";
+    if(send(fd, req, sizeof(req)-1, MSG_NOSIGNAL) != sizeof(req)-1) return FALSE;
+    size_t got = 0;
+    while(got < len - 1){
+        ssize_t r = read(fd, buf + got, len - 1 - got);
+        if(r < 1) return FALSE;
+        got += r;
+        if(buf[got-1] == '\n') return TRUE;
+    }
+    return FALSE;
+}
+
+// the same by library client
+static int clrequest(sl_sock_t *c, char *buf, size_t len){
+    if(sl_sock_sendstrmessage(c, "int\n") < 0) return FALSE;
+    ssize_t got;
+    while(0 == (got = sl_sock_readline(c, buf, len)))
+        if(!sl_sock_waitline(c, 1.)) return FALSE;
+    return got > 0;
+}
+
+static int cmpdbl(const void *a, const void *b){
+    double d1 = *(const double*)a, d2 = *(const double*)b;
+    return (d1 > d2) - (d1 < d2);
+}
+
+typedef struct{
+    int *fds;       // clients' descriptors
+    int nfds;       // their amount
+    int nreq;       // amount of requests to do
+} thrdata_t;
+
+// make `nreq` requests by all given clients in turn
+static void *clthread(void *d){
+    thrdata_t *t = (thrdata_t*)d;
+    char buf[256];
+    for(int i = 0; i < t->nreq; ++i)
+        if(!request(t->fds[i % t->nfds], buf, sizeof(buf))){
+            WARNX("No answer");
+            break;
+        }
+    return NULL;
+}
+
+// measure requests per second for `G.nthreads` parallel clients' threads
+static void throughput(int *fds, int nconn){
+    int nthr = G.nthreads;
+    if(nthr > nconn) nthr = nconn;
+    pthread_t *thr = MALLOC(pthread_t, nthr);
+    thrdata_t *td = MALLOC(thrdata_t, nthr);
+    int per = nconn / nthr;
+    double t0 = sl_dtime();
+    for(int i = 0; i < nthr; ++i){
+        td[i].fds = &fds[i * per];
+        td[i].nfds = per;
+        td[i].nreq = G.nmessages / nthr;
+        if(pthread_create(&thr[i], NULL, clthread, &td[i])) ERR("pthread_create()");
+    }
+    for(int i = 0; i < nthr; ++i) pthread_join(thr[i], NULL);
+    double total = sl_dtime() - t0;
+    printf("%d threads: %d requests in %.3fs, %.0f req/s\n", nthr, G.nmessages / nthr * nthr, total,
+           (G.nmessages / nthr * nthr) / total);
+    FREE(thr);
+    FREE(td);
+}
+
+typedef struct{
+    int *fds;       // clients' descriptors
+    int nfds;       // their amount
+    size_t expected;// amount of bytes each client should get
+    double tend;    // time when all data received
+} bcastdata_t;
+
+// read all broadcasted data by all clients
+static void *bcastreader(void *d){
+    bcastdata_t *b = (bcastdata_t*)d;
+    struct pollfd *pfds = MALLOC(struct pollfd, b->nfds);
+    size_t *got = MALLOC(size_t, b->nfds);
+    int ndone = 0;
+    char buf[65536];
+    for(int i = 0; i < b->nfds; ++i){
+        pfds[i].fd = b->fds[i];
+        pfds[i].events = POLLIN;
+    }
+    while(ndone < b->nfds){
+        if(poll(pfds, b->nfds, 1000) < 1){
+            WARNX("Broadcast: timeout, %d clients got all data", ndone);
+            break;
+        }
+        for(int i = 0; i < b->nfds; ++i){
+            if(!(pfds[i].revents & POLLIN)) continue;
+            ssize_t r = read(pfds[i].fd, buf, sizeof(buf));
+            if(r < 1){
+                WARNX("Client #%d disconnected", i);
+                pfds[i].fd = -1;
+                ++ndone;
+                continue;
+            }
+            got[i] += r;
+            if(got[i] == b->expected){
+                pfds[i].fd = -1; // don't poll it more
+                ++ndone;
+            }
+        }
+    }
+    b->tend = sl_dtime();
+    FREE(pfds);
+    FREE(got);
+    return NULL;
+}
+
+// measure time of `G.nmessages` broadcasts to all clients
+static void broadcast(sl_sock_t *s, int *fds, int nconn){
+    uint8_t *msg = MALLOC(uint8_t, G.bcastlen);
+    memset(msg, 'b', G.bcastlen - 1);
+    msg[G.bcastlen - 1] = '\n';
+    bcastdata_t b = {.fds = fds, .nfds = nconn, .expected = (size_t)G.nmessages * G.bcastlen};
+    pthread_t thr;
+    if(pthread_create(&thr, NULL, bcastreader, &b)) ERR("pthread_create()");
+    int nfail = 0;
+    double t0 = sl_dtime();
+    for(int i = 0; i < G.nmessages; ++i)
+        if(sl_sock_sendall(s, msg, G.bcastlen) != nconn) ++nfail;
+    double tsend = sl_dtime() - t0;
+    pthread_join(thr, NULL);
+    printf("Broadcast of %d messages (%d bytes) to %d clients: sendall() %.1f us/msg, all delivered in %.3fs",
+           G.nmessages, G.bcastlen, nconn, tsend / G.nmessages * 1e6, b.tend - t0);
+    if(nfail) printf(", %d incomplete sends", nfail);
+    printf("\n");
+    FREE(msg);
+}
+
+// read HTTP response: head and Content-Length bytes of body
+static int httpanswer(int fd, char *buf, size_t len){
+    size_t got = 0;
+    while(got < len - 1){
+        ssize_t r = read(fd, buf + got, len - 1 - got);
+        if(r < 1) return FALSE;
+        got += r;
+        buf[got] = 0;
+        char *body = strstr(buf, "\r\n\r\n"), *cl = strstr(buf, "Content-Length:");
+        if(!body) continue;
+        if(!cl) return FALSE;
+        if(got >= (size_t)(body + 4 - buf) + strtoul(cl + 15, NULL, 10)) return TRUE;
+    }
+    return FALSE;
+}
+
+// make `G.nmessages` HTTP requests (new connection for each if `reconnect`), return time of one request
+static double httprequests(sl_socktype_e type, const char *path, int reconnect){
+    static const char reqclose[] = "GET /int HTTP/1.1\r\nConnection: close\r\n\r\n", req[] = "GET /int HTTP/1.1\r\n\r\n";
+    const char *r = reconnect ? reqclose : req;
+    size_t l = reconnect ? sizeof(reqclose) - 1 : sizeof(req) - 1;
+    char buf[1024];
+    int fd = -1;
+    double t0 = sl_dtime();
+    for(int i = 0; i < G.nmessages; ++i){
+        if(fd < 0 && (fd = sl_sock_open(type, path, 0, 0)) < 0) ERRX("Can't connect");
+        if(send(fd, r, l, MSG_NOSIGNAL) != (ssize_t)l || !httpanswer(fd, buf, sizeof(buf))) ERRX("HTTP: no answer");
+        if(reconnect){
+            close(fd);
+            fd = -1;
+        }
+    }
+    double t = (sl_dtime() - t0) / G.nmessages;
+    if(fd > -1) close(fd);
+    return t;
+}
+
+int main(int argc, char **argv){
+    sl_init();
+    sl_parseargs(&argc, &argv, cmdlnopts);
+    if(G.help) sl_showhelp(-1, cmdlnopts);
+    if(G.nclients < 1 || G.nmessages < 1) ERRX("Wrong parameters");
+    // each client needs two descriptors: its own and server's
+    struct rlimit rl;
+    if(0 == getrlimit(RLIMIT_NOFILE, &rl)){
+        rlim_t need = 2 * (rlim_t)G.nclients + 64;
+        if(rl.rlim_cur < need){
+            rl.rlim_cur = (rl.rlim_max < need) ? rl.rlim_max : need;
+            if(setrlimit(RLIMIT_NOFILE, &rl)) WARN("setrlimit()");
+            if(rl.rlim_cur < need){
+                G.nclients = (int)(rl.rlim_cur - 64) / 2;
+                WARNX("Descriptors limit is %lu, decrease clients amount to %d", (unsigned long)rl.rlim_cur, G.nclients);
+            }
+        }
+    }
+    const char *path = G.port ? G.port : "\\0sockbench";
+    sl_socktype_e type = G.port ? SOCKT_NETLOCAL : SOCKT_UNIX;
+    // HTTP client reconnects just after answer, when server could still close its previous connection
+    sl_sock_srvopts_t opts = {.maxclients = G.nclients + (G.libclient ? 1 : 0) + (G.http ? 2 : 0), .evmode = G.epoll ? SOCKEV_EPOLL : SOCKEV_POLL,
+                              .nworkers = G.nworkers};
+    sl_sock_t *s = sl_sock_run_server_ext(type, path, -1, handlers, &opts);
+    if(!s) ERRX("Can't run server");
+    int *fds = MALLOC(int, G.nclients);
+    int nconn = 0;
+    for(; nconn < G.nclients; ++nconn){
+        fds[nconn] = sl_sock_open(type, path, 0, 0);
+        if(fds[nconn] < 0){
+            WARNX("Can't connect client #%d", nconn);
+            break;
+        }
+    }
+    if(!nconn) ERRX("No clients connected");
+    char buf[256];
+    // check that all clients are served before measurements
+    for(int i = 0; i < nconn; ++i)
+        if(!request(fds[i], buf, sizeof(buf))) ERRX("Client #%d: no answer", i);
+    green("%s server, %d workers, %d clients\n", s->evmode == SOCKEV_EPOLL ? "epoll()" : "poll()",
+          G.nworkers, nconn);
+    if(G.nthreads > 0){
+        throughput(fds, nconn);
+        goto ret;
+    }
+    if(G.bcastlen > 0){
+        broadcast(s, fds, nconn);
+        goto ret;
+    }
+    if(G.http){
+        double tnew = httprequests(type, path, TRUE), tka = httprequests(type, path, FALSE);
+        printf("HTTP requests (us): %.1f with new connection, %.1f in keep-alive connection\n", tnew * 1e6, tka * 1e6);
+        goto ret;
+    }
+    double t0 = sl_dtime(), c0 = cputime();
+    usleep((useconds_t)(G.idletime * 1e6));
+    double cpu = (cputime() - c0) / (sl_dtime() - t0) * 100.;
+    printf("Idle CPU usage: %.1f%%\n", cpu);
+    double *lat = MALLOC(double, G.nmessages);
+    sl_sock_t *c = NULL;
+    if(G.libclient && !(c = sl_sock_run_client(type, path, -1))) ERRX("Can't run client");
+    t0 = sl_dtime();
+    for(int i = 0; i < G.nmessages; ++i){
+        double t = sl_dtime();
+        if(c){
+            if(!clrequest(c, buf, sizeof(buf))) ERRX("Library client: no answer");
+        }else if(!request(fds[i % nconn], buf, sizeof(buf))) ERRX("Client #%d: no answer", i % nconn);
+        lat[i] = sl_dtime() - t;
+    }
+    sl_sock_delete(&c);
+    double total = sl_dtime() - t0;
+    qsort(lat, G.nmessages, sizeof(double), cmpdbl);
+    printf("Latency (us): mean=%.1f, median=%.1f, 99%%=%.1f, max=%.1f\n",
+           total / G.nmessages * 1e6, lat[G.nmessages / 2] * 1e6,
+           lat[(int)(G.nmessages * 0.99)] * 1e6, lat[G.nmessages - 1] * 1e6);
+    FREE(lat);
+ret:
+    for(int i = 0; i < nconn; ++i) close(fds[i]);
+    FREE(fds);
+    sl_sock_delete(&s);
+    return 0;
+}
@@ -22,17 +22,14 @@
 #include "usefull_macros.h"
 
 /**
- * @brief sl_list_push_tail - push data into the tail of a stack (like FIFO)
+ * @brief sl_ilist_push_tail - push node into the tail of list (FIFO) without allocation
  * @param lst (io) - list
- * @param v (i)    - data to push (DON'T FREE it after this function as it would be just a link to original!)
- * @return pointer to just pused node or NULL in case of error
+ * @param node (i) - node (e.g. embedded into user's structure, see SL_CONTAINER_OF)
+ * @return `node` or NULL in case of error
  */
-sl_list_t *sl_list_push_tail(sl_list_t **lst, void *v){
-    sl_list_t *node;
-    if(!lst) return NULL;
-    if((node = MALLOC(sl_list_t, 1)) == NULL)
-        return NULL; // allocation error
-    node->data = v; // insert data
+sl_list_t *sl_ilist_push_tail(sl_list_t **lst, sl_list_t *node){
+    if(!lst || !node) return NULL;
+    node->next = NULL;
     if(!*lst){
         *lst = node;
     }else{
@@ -42,6 +39,52 @@ sl_list_t *sl_list_push_tail(sl_list_t **lst, void *v){
     return node;
 }
 
+/**
+ * @brief sl_ilist_push - push node into the head of list (LIFO) without allocation
+ * @param lst (io) - list
+ * @param node (i) - node
+ * @return `node` or NULL in case of error
+ */
+sl_list_t *sl_ilist_push(sl_list_t **lst, sl_list_t *node){
+    if(!lst || !node) return NULL;
+    if(!*lst){
+        node->next = NULL;
+        node->last = node;
+    }else{
+        node->next = *lst;
+        node->last = (*lst)->last;
+    }
+    *lst = node;
+    return node;
+}
+
+/**
+ * @brief sl_ilist_pop - remove node from the head of list (memory of node isn't touched)
+ * @param lst (io) - list
+ * @return head node or NULL if list is empty
+ */
+sl_list_t *sl_ilist_pop(sl_list_t **lst){
+    if(!lst || !*lst) return NULL;
+    sl_list_t *node = *lst;
+    *lst = node->next;
+    if(*lst) (*lst)->last = node->last; // only head knows the tail
+    node->next = NULL;
+    return node;
+}
+
+/**
+ * @brief sl_list_push_tail - push data into the tail of a stack (like FIFO)
+ * @param lst (io) - list
+ * @param v (i)    - data to push (DON'T FREE it after this function as it would be just a link to original!)
+ * @return pointer to just pused node or NULL in case of error
+ */
+sl_list_t *sl_list_push_tail(sl_list_t **lst, void *v){
+    if(!lst) return NULL;
+    sl_list_t *node = MALLOC(sl_list_t, 1);
+    node->data = v; // insert data
+    return sl_ilist_push_tail(lst, node);
+}
+
 /**
  * @brief sl_list_push - push data into the head of a stack (like LIFO)
  * @param lst (io) - list
@@ -49,20 +92,10 @@ sl_list_t *sl_list_push_tail(sl_list_t **lst, void *v){
  * @return pointer to just pused node
  */
 sl_list_t *sl_list_push(sl_list_t **lst, void *v){
-    sl_list_t *node;
     if(!lst) return NULL;
-    if((node = MALLOC(sl_list_t, 1)) == NULL)
-        return NULL; // allocation error
+    sl_list_t *node = MALLOC(sl_list_t, 1);
     node->data = v; // insert data
-    if(!*lst){
-        *lst = node;
-        (*lst)->last = node;
-        return node;
-    }
-    node->next = *lst;
-    node->last = (*lst)->last;
-    *lst = node;
-    return node;
+    return sl_ilist_push(lst, node);
 }
 
 /**
@@ -71,11 +104,73 @@ sl_list_t *sl_list_push(sl_list_t **lst, void *v){
  * @return data from lst head
  */
 void *sl_list_pop(sl_list_t **lst){
-    void *ret;
-    sl_list_t *node = *lst;
-    if(!lst || !*lst) return NULL;
-    ret = (*lst)->data;
-    *lst = (*lst)->next;
+    sl_list_t *node = sl_ilist_pop(lst);
+    if(!node) return NULL;
+    void *ret = node->data;
     FREE(node);
     return ret;
 }
+
+/**
+ * @brief sl_plist_new - create list which takes its nodes from own pool
+ * @param nperslab - amount of nodes allocated at once (0 - SL_DEF_POOLSLAB)
+ * @return list or die
+ */
+sl_plist_t *sl_plist_new(size_t nperslab){
+    sl_plist_t *l = MALLOC(sl_plist_t, 1);
+    l->pool = sl_pool_new(sizeof(sl_list_t), nperslab);
+    return l;
+}
+
+/**
+ * @brief sl_plist_push_tail - push data into the tail of pooled list (like FIFO)
+ * @param l (io) - list
+ * @param v (i)  - data to push (just a link)
+ * @return pointer to just pushed node or NULL in case of error
+ */
+sl_list_t *sl_plist_push_tail(sl_plist_t *l, void *v){
+    if(!l) return NULL;
+    sl_list_t *node = POOL_ALLOC(l->pool, sl_list_t);
+    node->data = v;
+    ++l->n;
+    return sl_ilist_push_tail(&l->head, node);
+}
+
+/**
+ * @brief sl_plist_push - push data into the head of pooled list (like LIFO)
+ * @param l (io) - list
+ * @param v (i)  - data to push
+ * @return pointer to just pushed node or NULL in case of error
+ */
+sl_list_t *sl_plist_push(sl_plist_t *l, void *v){
+    if(!l) return NULL;
+    sl_list_t *node = POOL_ALLOC(l->pool, sl_list_t);
+    node->data = v;
+    ++l->n;
+    return sl_ilist_push(&l->head, node);
+}
+
+/**
+ * @brief sl_plist_pop - get data from head of pooled list, its node returns to the pool
+ * @param l (io) - list
+ * @return data from list head or NULL if list is empty
+ */
+void *sl_plist_pop(sl_plist_t *l){
+    if(!l) return NULL;
+    sl_list_t *node = sl_ilist_pop(&l->head);
+    if(!node) return NULL;
+    void *ret = node->data;
+    sl_pool_free(l->pool, node);
+    --l->n;
+    return ret;
+}
+
+/**
+ * @brief sl_plist_delete - free pooled list with all its nodes (data isn't freed)
+ * @param l - list
+ */
+void sl_plist_delete(sl_plist_t **l){
+    if(!l || !*l) return;
+    sl_pool_delete(&(*l)->pool);
+    FREE(*l);
+}
@@ -0,0 +1,312 @@
+/*
+ * This file is part of the Snippets project.
+ * Copyright 2026 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "usefull_macros.h"
+
+/*
+ * Robin Hood open addressing: item is inserted at its ideal cell or after it, and takes cell from
+ * item which is closer to its own ideal cell ("rich"); so lookup stops as soon as it meets item
+ * closer to its ideal cell than the searched key would be. Deletion shifts the following items back.
+ */
+
+// table cell
+typedef struct{
+    uint32_t hash;          // full hash of key
+    uint32_t dist;          // distance from ideal cell + 1 (0 - empty cell)
+    union{
+        const char *str;
+        int64_t num;
+    } key;
+    void *val;
+} hcell_t;
+
+struct sl_hmap{
+    sl_hmapkey_e type;      // type of keys
+    hcell_t *cells;         // table
+    size_t mask;            // table size - 1 (size is power of 2)
+    size_t n;               // amount of items
+};
+
+// min table size
+#define HMAP_MINSZ      (8)
+// table grows when amount of items is more than 3/4 of its size
+#define HMAP_FULL(sz)   ((sz) / 4 * 3)
+
+// FNV-1a hash of first `len` bytes of `key`
+static uint32_t strhash(const char *key, size_t len){
+    uint32_t h = 2166136261u;
+    for(size_t i = 0; i < len; ++i){
+        h ^= (uint8_t)key[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// mix all bits of integer key (finalizer of splitmix64)
+static uint32_t numhash(int64_t key){
+    uint64_t x = (uint64_t)key;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return (uint32_t)(x ^ (x >> 31));
+}
+
+// compare key of cell `c` with given key (`len` is length of string key)
+static inline int keyeq(const sl_hmap_t *m, const hcell_t *c, const char *str, size_t len, int64_t num){
+    if(m->type == SL_HMAP_INTKEYS) return c->key.num == num;
+    return 0 == strncmp(c->key.str, str, len) && c->key.str[len] == 0;
+}
+
+// find cell with given key or NULL
+static hcell_t *findcell(const sl_hmap_t *m, uint32_t hash, const char *str, size_t len, int64_t num){
+    size_t idx = hash & m->mask;
+    for(uint32_t dist = 1; ; ++dist, idx = (idx + 1) & m->mask){
+        hcell_t *c = &m->cells[idx];
+        if(c->dist < dist) return NULL; // empty cell or "richer" item: our key would be here
+        if(c->hash == hash && keyeq(m, c, str, len, num)) return c;
+    }
+}
+
+// put new item `in` into table (key is absent and there's free space)
+static void insertcell(sl_hmap_t *m, hcell_t in){
+    size_t idx = in.hash & m->mask;
+    in.dist = 1;
+    for(;; ++in.dist, idx = (idx + 1) & m->mask){
+        hcell_t *c = &m->cells[idx];
+        if(!c->dist){
+            *c = in;
+            return;
+        }
+        if(c->dist < in.dist){ // take cell of richer item and continue with it
+            hcell_t tmp = *c;
+            *c = in;
+            in = tmp;
+        }
+    }
+}
+
+// resize table to `sz` cells
+static void rehash(sl_hmap_t *m, size_t sz){
+    hcell_t *old = m->cells;
+    size_t oldsz = old ? m->mask + 1 : 0;
+    m->cells = MALLOC(hcell_t, sz);
+    m->mask = sz - 1;
+    for(size_t i = 0; i < oldsz; ++i)
+        if(old[i].dist) insertcell(m, old[i]);
+    FREE(old);
+}
+
+/**
+ * @brief sl_hmap_new - create hash map
+ * @param type - type of keys: SL_HMAP_STRKEYS (strings) or SL_HMAP_INTKEYS (int64_t)
+ * @param nitems - expected amount of items (map grows if needed)
+ * @return map or die
+ */
+sl_hmap_t *sl_hmap_new(sl_hmapkey_e type, size_t nitems){
+    sl_hmap_t *m = MALLOC(sl_hmap_t, 1);
+    m->type = type;
+    size_t sz = HMAP_MINSZ;
+    while(HMAP_FULL(sz) < nitems) sz <<= 1;
+    rehash(m, sz);
+    return m;
+}
+
+/**
+ * @brief sl_hmap_delete - free hash map (keys and values aren't freed)
+ * @param m - map
+ */
+void sl_hmap_delete(sl_hmap_t **m){
+    if(!m || !*m) return;
+    FREE((*m)->cells);
+    FREE(*m);
+}
+
+/**
+ * @brief sl_hmap_count - amount of items in map
+ * @param m - map
+ * @return amount of items
+ */
+size_t sl_hmap_count(const sl_hmap_t *m){
+    return m ? m->n : 0;
+}
+
+// add or replace item
+static int hmap_put(sl_hmap_t *m, uint32_t hash, const char *str, size_t len, int64_t num, void *val){
+    hcell_t *c = findcell(m, hash, str, len, num);
+    if(c){
+        c->val = val;
+        return FALSE;
+    }
+    if(m->n + 1 > HMAP_FULL(m->mask + 1)) rehash(m, (m->mask + 1) * 2);
+    hcell_t in = {.hash = hash, .val = val};
+    if(m->type == SL_HMAP_INTKEYS) in.key.num = num;
+    else in.key.str = str;
+    insertcell(m, in);
+    ++m->n;
+    return TRUE;
+}
+
+// remove cell `c` shifting back items after it
+static void removecell(sl_hmap_t *m, hcell_t *c){
+    size_t idx = c - m->cells;
+    for(;;){
+        size_t nxt = (idx + 1) & m->mask;
+        hcell_t *n = &m->cells[nxt];
+        if(n->dist < 2) break; // empty or at its ideal place
+        m->cells[idx] = *n;
+        --m->cells[idx].dist;
+        idx = nxt;
+    }
+    m->cells[idx].dist = 0;
+    --m->n;
+}
+
+/**
+ * @brief sl_hmap_put - add item with string key or replace its value
+ * @param m - map with SL_HMAP_STRKEYS
+ * @param key - key (isn't copied, so it should live while it is in map)
+ * @param val - value
+ * @return TRUE if new item added, FALSE if value replaced or wrong arguments
+ */
+int sl_hmap_put(sl_hmap_t *m, const char *key, void *val){
+    if(!m || !key || m->type != SL_HMAP_STRKEYS) return FALSE;
+    size_t len = strlen(key);
+    return hmap_put(m, strhash(key, len), key, len, 0, val);
+}
+
+/**
+ * @brief sl_hmap_getn - find value by first `len` bytes of string key
+ * @param m - map with SL_HMAP_STRKEYS
+ * @param key - key (not obligatory zero-terminated)
+ * @param len - its length
+ * @param val (o) - value (if found, could be NULL)
+ * @return TRUE if found
+ */
+int sl_hmap_getn(const sl_hmap_t *m, const char *key, size_t len, void **val){
+    if(!m || !key || m->type != SL_HMAP_STRKEYS) return FALSE;
+    hcell_t *c = findcell(m, strhash(key, len), key, len, 0);
+    if(!c) return FALSE;
+    if(val) *val = c->val;
+    return TRUE;
+}
+
+/**
+ * @brief sl_hmap_get - find value by string key
+ * @param m - map with SL_HMAP_STRKEYS
+ * @param key - key
+ * @return value or NULL if not found
+ */
+void *sl_hmap_get(const sl_hmap_t *m, const char *key){
+    void *val = NULL;
+    if(key) sl_hmap_getn(m, key, strlen(key), &val);
+    return val;
+}
+
+/**
+ * @brief sl_hmap_del - remove item with string key
+ * @param m - map with SL_HMAP_STRKEYS
+ * @param key - key
+ * @return TRUE if removed, FALSE if not found
+ */
+int sl_hmap_del(sl_hmap_t *m, const char *key){
+    if(!m || !key || m->type != SL_HMAP_STRKEYS) return FALSE;
+    size_t len = strlen(key);
+    hcell_t *c = findcell(m, strhash(key, len), key, len, 0);
+    if(!c) return FALSE;
+    removecell(m, c);
+    return TRUE;
+}
+
+/**
+ * @brief sl_hmap_puti - add item with integer key or replace its value
+ * @param m - map with SL_HMAP_INTKEYS
+ * @param key - key
+ * @param val - value
+ * @return TRUE if new item added, FALSE if value replaced or wrong arguments
+ */
+int sl_hmap_puti(sl_hmap_t *m, int64_t key, void *val){
+    if(!m || m->type != SL_HMAP_INTKEYS) return FALSE;
+    return hmap_put(m, numhash(key), NULL, 0, key, val);
+}
+
+/**
+ * @brief sl_hmap_geti - find value by integer key
+ * @param m - map with SL_HMAP_INTKEYS
+ * @param key - key
+ * @param val (o) - value (if found, could be NULL)
+ * @return TRUE if found
+ */
+int sl_hmap_geti(const sl_hmap_t *m, int64_t key, void **val){
+    if(!m || m->type != SL_HMAP_INTKEYS) return FALSE;
+    hcell_t *c = findcell(m, numhash(key), NULL, 0, key);
+    if(!c) return FALSE;
+    if(val) *val = c->val;
+    return TRUE;
+}
+
+/**
+ * @brief sl_hmap_deli - remove item with integer key
+ * @param m - map with SL_HMAP_INTKEYS
+ * @param key - key
+ * @return TRUE if removed, FALSE if not found
+ */
+int sl_hmap_deli(sl_hmap_t *m, int64_t key){
+    if(!m || m->type != SL_HMAP_INTKEYS) return FALSE;
+    hcell_t *c = findcell(m, numhash(key), NULL, 0, key);
+    if(!c) return FALSE;
+    removecell(m, c);
+    return TRUE;
+}
+
+/**
+ * @brief sl_hmap_options - build map of options array (if some keys are equal, the first option wins
+ *        like in linear search)
+ * @param options - array of options (ends with `end_option`)
+ * @param byshort - FALSE to use long names (`name`) as keys, TRUE to use short options (`val`)
+ * @return map with pointers to options as values or NULL if `options` is empty
+ */
+sl_hmap_t *sl_hmap_options(sl_option_t *options, int byshort){
+    if(!options) return NULL;
+    size_t n = 0;
+    for(sl_option_t *o = options; o->help; ++o) ++n;
+    if(!n) return NULL;
+    sl_hmap_t *m = sl_hmap_new(byshort ? SL_HMAP_INTKEYS : SL_HMAP_STRKEYS, n);
+    for(size_t i = n; i > 0; --i){ // backwards: first of equal keys overwrites others
+        sl_option_t *o = &options[i-1];
+        if(byshort) sl_hmap_puti(m, o->val, o);
+        else if(o->name) sl_hmap_put(m, o->name, o);
+    }
+    return m;
+}
+
+/**
+ * @brief sl_hmap_hitems - build map of socket handlers' keys (the first of equal keys wins)
+ * @param items - array of handlers (ends with NULL handler)
+ * @return map with pointers to `items` as values or NULL if `items` is empty
+ */
+sl_hmap_t *sl_hmap_hitems(sl_sock_hitem_t *items){
+    if(!items) return NULL;
+    size_t n = 0;
+    for(sl_sock_hitem_t *h = items; h->handler; ++h) ++n;
+    if(!n) return NULL;
+    sl_hmap_t *m = sl_hmap_new(SL_HMAP_STRKEYS, n);
+    for(size_t i = n; i > 0; --i)
+        if(items[i-1].key) sl_hmap_put(m, items[i-1].key, &items[i-1]);
+    return m;
+}
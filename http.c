@@ -0,0 +1,324 @@
+/*
+ * This file is part of the Snippets project.
+ * Copyright 2026 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include "usefull_macros.h"
+
+/*
+ * Incremental HTTP/1.x request parser. Data of request should stay in the same buffer between calls
+ * (buffer could be moved, new data is appended to the end), so each byte of head is scanned only once:
+ * head is split into slices when the empty line after headers comes, body is waited by its length or
+ * by sizes of chunks. Chunked body is decoded in place when the last chunk comes.
+ */
+
+// stages of chunked body
+enum{
+    CHUNK_SIZE = 0, // waiting for line with chunk size
+    CHUNK_DATA,     // waiting for chunk data and its CRLF
+    CHUNK_TRAILER,  // waiting for trailer headers and empty line
+};
+
+static const char *methods[SOCKM_AMOUNT] = {
+    [SOCKM_GET] = "GET",
+    [SOCKM_PUT] = "PUT",
+    [SOCKM_POST] = "POST",
+    [SOCKM_PATCH] = "PATCH",
+    [SOCKM_DELETE] = "DELETE"
+};
+
+/**
+ * @brief sl_http_method - get method by its name
+ * @param str - name (not obligatory zero-terminated)
+ * @param len - its length
+ * @return method or SOCKM_RAW if unknown
+ */
+sl_sockmethod_e sl_http_method(const char *str, size_t len){
+    if(!str) return SOCKM_RAW;
+    for(sl_sockmethod_e m = SOCKM_GET; m < SOCKM_AMOUNT; ++m)
+        if(strlen(methods[m]) == len && 0 == strncmp(str, methods[m], len)) return m;
+    return SOCKM_RAW;
+}
+
+/**
+ * @brief sl_http_init - prepare parser for new request
+ * @param r - request
+ */
+void sl_http_init(sl_httpreq_t *r){
+    if(!r) return;
+    memset(r, 0, sizeof(sl_httpreq_t));
+    r->method = SOCKM_RAW;
+}
+
+// case-insensitive comparison of slice with string (lengths are compared first: slice could contain zeros)
+static int sliceis(const char *str, size_t len, const char *s){
+    return strlen(s) == len && 0 == strncasecmp(str, s, len);
+}
+
+// trim spaces and tabs from both ends of slice
+static void trim(const char **str, size_t *len){
+    while(*len && (**str == ' ' || **str == '\t')){ ++*str; --*len; }
+    while(*len && ((*str)[*len-1] == ' ' || (*str)[*len-1] == '\t' || (*str)[*len-1] == '\r')) --*len;
+}
+
+// check if comma-separated list `str` contains `token`
+static int hastoken(const char *str, size_t len, const char *token){
+    const char *end = str + len;
+    while(str < end){
+        const char *comma = memchr(str, ',', end - str);
+        if(!comma) comma = end;
+        const char *t = str;
+        size_t l = comma - str;
+        trim(&t, &l);
+        if(sliceis(t, l, token)) return TRUE;
+        str = comma + 1;
+    }
+    return FALSE;
+}
+
+// length of line starting at `str` (without "\n" or "\r\n")
+static size_t linelen(const char *str, const char *eol){
+    size_t l = eol - str;
+    if(l && str[l-1] == '\r') --l;
+    return l;
+}
+
+// parse request line: METHOD SP target SP HTTP/1.x
+static int parsereqline(sl_httpreq_t *r, const char *str, size_t len){
+    const char *sp1 = memchr(str, ' ', len);
+    if(!sp1 || sp1 == str) return FALSE;
+    r->method = sl_http_method(str, sp1 - str);
+    const char *target = sp1 + 1, *end = str + len;
+    const char *sp2 = memchr(target, ' ', end - target);
+    if(!sp2 || sp2 == target) return FALSE;
+    r->target.ptr = target;
+    r->target.len = sp2 - target;
+    const char *ver = sp2 + 1;
+    if(end - ver != 8 || strncmp(ver, "HTTP/1.", 7) || ver[7] < '0' || ver[7] > '9') return FALSE;
+    r->minor = ver[7] - '0';
+    r->keepalive = (r->minor > 0); // HTTP/1.0 closes connection by default
+    return TRUE;
+}
+
+// parse decimal Content-Length
+static int parsecontlen(sl_httpreq_t *r, const char *str, size_t len){
+    if(!len) return FALSE;
+    size_t l = 0;
+    for(size_t i = 0; i < len; ++i){
+        if(str[i] < '0' || str[i] > '9') return FALSE;
+        if(l > (SIZE_MAX - 9) / 10) return FALSE;
+        l = l * 10 + (str[i] - '0');
+    }
+    if(r->hascontlen && r->contlen != l) return FALSE; // different values
+    r->hascontlen = TRUE;
+    r->contlen = l;
+    return TRUE;
+}
+
+// parse header line `name: value`
+static int parseheader(sl_httpreq_t *r, const char *str, size_t len){
+    if(*str == ' ' || *str == '\t') return FALSE; // obsolete line folding
+    if(memchr(str, 0, len)) return FALSE; // zeros aren't allowed in name and value
+    const char *colon = memchr(str, ':', len);
+    if(!colon || colon == str) return FALSE;
+    size_t nlen = colon - str;
+    if(memchr(str, ' ', nlen) || memchr(str, '\t', nlen)) return FALSE;
+    const char *val = colon + 1;
+    size_t vlen = len - nlen - 1;
+    trim(&val, &vlen);
+    if(r->nheaders < SL_HTTP_MAXHDRS){
+        sl_httphdr_t *h = &r->headers[r->nheaders++];
+        h->name.ptr = str;
+        h->name.len = nlen;
+        h->value.ptr = val;
+        h->value.len = vlen;
+    }
+    if(sliceis(str, nlen, "Content-Length")) return parsecontlen(r, val, vlen);
+    if(sliceis(str, nlen, "Transfer-Encoding")){
+        if(!hastoken(val, vlen, "chunked")) return FALSE; // can't get length of body
+        r->chunked = TRUE;
+    }else if(sliceis(str, nlen, "Connection")){
+        if(hastoken(val, vlen, "close")) r->keepalive = FALSE;
+        else if(hastoken(val, vlen, "keep-alive")) r->keepalive = TRUE;
+    }else if(sliceis(str, nlen, "Expect")){
+        if(sliceis(val, vlen, "100-continue")) r->expectcont = TRUE;
+    }
+    return TRUE;
+}
+
+// split head (`hdrlen` bytes from `start`) into request line and headers
+static int parsehead(sl_httpreq_t *r, const char *buf){
+    const char *str = buf + r->start, *end = buf + r->hdrlen;
+    int first = TRUE;
+    while(str < end){
+        const char *eol = memchr(str, '\n', end - str);
+        size_t l = linelen(str, eol);
+        if(l == 0) break; // empty line - end of head
+        if(first){
+            if(!parsereqline(r, str, l)) return FALSE;
+            first = FALSE;
+        }else if(!parseheader(r, str, l)) return FALSE;
+        str = eol + 1;
+    }
+    return TRUE;
+}
+
+// parse hexadecimal chunk size (`len` is length of line); return FALSE if bad
+static int parsechunksize(const char *str, size_t len, size_t *size){
+    size_t s = 0, i = 0;
+    for(; i < len; ++i){
+        char c = str[i];
+        int d;
+        if(c >= '0' && c <= '9') d = c - '0';
+        else if(c >= 'a' && c <= 'f') d = c - 'a' + 10;
+        else if(c >= 'A' && c <= 'F') d = c - 'A' + 10;
+        else break;
+        if(s > (SIZE_MAX >> 4)) return FALSE;
+        s = (s << 4) | (size_t)d;
+    }
+    if(i == 0) return FALSE;
+    if(i < len && str[i] != ';' && str[i] != ' ' && str[i] != '\t') return FALSE; // only extensions allowed
+    *size = s;
+    return TRUE;
+}
+
+// move all chunks' data to the beginning of body
+static void dechunk(sl_httpreq_t *r, char *buf){
+    char *src = buf + r->hdrlen, *dst = src;
+    r->body.ptr = dst;
+    while(1){
+        char *eol = memchr(src, '\n', buf + r->reqlen - src);
+        size_t size = 0;
+        parsechunksize(src, linelen(src, eol), &size); // it was checked already
+        if(!size) break;
+        src = eol + 1;
+        memmove(dst, src, size);
+        dst += size;
+        src += size;
+        src += (*src == '\r') ? 2 : 1;
+    }
+    r->body.len = dst - r->body.ptr;
+}
+
+// go through chunks got after last call
+static sl_httpstate_e parsechunks(sl_httpreq_t *r, char *buf, size_t len){
+    while(r->pos < len){
+        const char *str = buf + r->pos, *eol;
+        switch(r->chunkstage){
+            case CHUNK_SIZE:
+                if(!(eol = memchr(str, '\n', len - r->pos))) return SL_HTTP_CHUNKS;
+                if(!parsechunksize(str, linelen(str, eol), &r->contlen)) return SL_HTTP_ERROR;
+                r->pos = eol + 1 - buf;
+                r->chunkstage = r->contlen ? CHUNK_DATA : CHUNK_TRAILER;
+            break;
+            case CHUNK_DATA:
+                if(len - r->pos <= r->contlen) return SL_HTTP_CHUNKS;
+                str += r->contlen;
+                if(*str == '\r'){
+                    if(len - r->pos < r->contlen + 2) return SL_HTTP_CHUNKS;
+                    if(str[1] != '\n') return SL_HTTP_ERROR;
+                    r->pos += r->contlen + 2;
+                }else if(*str == '\n') r->pos += r->contlen + 1;
+                else return SL_HTTP_ERROR;
+                r->chunkstage = CHUNK_SIZE;
+            break;
+            default: // trailer: skip all headers till empty line
+                if(!(eol = memchr(str, '\n', len - r->pos))) return SL_HTTP_CHUNKS;
+                r->pos = eol + 1 - buf;
+                if(linelen(str, eol)) break;
+                r->reqlen = r->pos;
+                dechunk(r, buf);
+                return SL_HTTP_DONE;
+        }
+    }
+    return SL_HTTP_CHUNKS;
+}
+
+// move slices to new place of buffer
+static void rebase(sl_httpreq_t *r, const char *buf){
+    #define REBASE(s)   do{if(s.ptr) s.ptr = buf + (s.ptr - r->base);}while(0)
+    REBASE(r->target);
+    for(int i = 0; i < r->nheaders; ++i){
+        REBASE(r->headers[i].name);
+        REBASE(r->headers[i].value);
+    }
+    #undef REBASE
+}
+
+/**
+ * @brief sl_http_parse - parse request (call it each time new data comes)
+ * @param r - request (prepared by `sl_http_init`)
+ * @param buf - all data got after the previous request: the same bytes as at previous call and new ones
+ *        (chunked body is decoded in place)
+ * @param len - length of data
+ * @return SL_HTTP_DONE when request is complete (its length is `r->reqlen`, the rest of `buf` is the
+ *         next request), SL_HTTP_ERROR if request is bad, else stage of waiting for more data
+ */
+sl_httpstate_e sl_http_parse(sl_httpreq_t *r, char *buf, size_t len){
+    if(!r || !buf) return SL_HTTP_ERROR;
+    if(r->state == SL_HTTP_DONE || r->state == SL_HTTP_ERROR) return r->state;
+    if(r->base && r->base != buf) rebase(r, buf);
+    r->base = buf;
+    if(r->state == SL_HTTP_HEAD){ // find empty line after headers
+        while(1){
+            if(r->pos >= len) return SL_HTTP_HEAD;
+            const char *str = buf + r->pos, *eol = memchr(str, '\n', len - r->pos);
+            if(!eol) return SL_HTTP_HEAD;
+            r->pos = eol + 1 - buf;
+            if(linelen(str, eol)) continue;
+            if(str == buf + r->start){ // empty lines before request line should be ignored
+                r->start = r->pos;
+                continue;
+            }
+            break;
+        }
+        r->hdrlen = r->pos;
+        if(!parsehead(r, buf)) return (r->state = SL_HTTP_ERROR);
+        if(r->chunked){ // Content-Length is ignored
+            r->contlen = 0;
+            r->state = SL_HTTP_CHUNKS;
+        }else if(r->contlen) r->state = SL_HTTP_BODY;
+        else{
+            r->body.ptr = buf + r->hdrlen;
+            r->reqlen = r->hdrlen;
+            return (r->state = SL_HTTP_DONE);
+        }
+    }
+    if(r->state == SL_HTTP_BODY){
+        if(len - r->hdrlen < r->contlen) return SL_HTTP_BODY;
+        r->body.ptr = buf + r->hdrlen;
+        r->body.len = r->contlen;
+        r->reqlen = r->hdrlen + r->contlen;
+        return (r->state = SL_HTTP_DONE);
+    }
+    return (r->state = parsechunks(r, buf, len));
+}
+
+/**
+ * @brief sl_http_header - find value of header (the first of headers with the same name)
+ * @param r - request with parsed head
+ * @param name - name of header (case-insensitive)
+ * @return value or NULL if not found
+ */
+const sl_strslice_t *sl_http_header(const sl_httpreq_t *r, const char *name){
+    if(!r || !name) return NULL;
+    for(int i = 0; i < r->nheaders; ++i)
+        if(sliceis(r->headers[i].name.ptr, r->headers[i].name.len, name)) return &r->headers[i].value;
+    return NULL;
+}
@@ -0,0 +1,217 @@
+/*
+ * This file is part of the Snippets project.
+ * Copyright 2026 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "usefull_macros.h"
+
+// memory chunk of arena or pool's slab; data starts at CHUNKHDR offset
+typedef struct sl_memchunk{
+    struct sl_memchunk *next;   // next (older) chunk
+    size_t size;                // size of data
+    size_t used;                // bytes of data used
+} memchunk_t;
+
+#define MEMALIGN(x)     (((x) + SL_MEM_ALIGN - 1) & ~((size_t)SL_MEM_ALIGN - 1))
+#define CHUNKHDR        MEMALIGN(sizeof(memchunk_t))
+#define CHUNKDATA(c)    ((uint8_t*)(c) + CHUNKHDR)
+
+// allocate new chunk with `size` bytes of data (not zeroed) or die
+static memchunk_t *newchunk(size_t size){
+    if(size > SIZE_MAX - CHUNKHDR) ERRX(_("Too large memory block: %zd bytes"), size);
+    memchunk_t *c = malloc(CHUNKHDR + size);
+    if(!c) ERR("malloc");
+    c->next = NULL;
+    c->size = size;
+    c->used = 0;
+    return c;
+}
+
+// free all chunks except the first (current) one and return it
+static memchunk_t *freechunks(memchunk_t *c){
+    if(!c) return NULL;
+    memchunk_t *nxt = c->next;
+    while(nxt){
+        memchunk_t *n = nxt->next;
+        free(nxt);
+        nxt = n;
+    }
+    c->next = NULL;
+    c->used = 0;
+    return c;
+}
+
+/**
+ * @brief sl_arena_new - create new arena (region) allocator
+ * @param chunksize - size of arena's memory chunks (0 - SL_DEF_ARENACHUNK)
+ * @return arena or die
+ */
+sl_arena_t *sl_arena_new(size_t chunksize){
+    if(!chunksize) chunksize = SL_DEF_ARENACHUNK;
+    chunksize = MEMALIGN(chunksize);
+    sl_arena_t *a = MALLOC(sl_arena_t, 1);
+    a->chunksize = chunksize;
+    a->head = newchunk(chunksize);
+    return a;
+}
+
+/**
+ * @brief sl_arena_alloc - allocate zero-filled array from arena (like `sl_alloc`)
+ * @param a - arena
+ * @param N - number of elements to allocate
+ * @param S - size of single element
+ * @return pointer aligned to SL_MEM_ALIGN (NULL if a is NULL) or die; memory lives until `sl_arena_reset` or `sl_arena_delete`
+ */
+void *sl_arena_alloc(sl_arena_t *a, size_t N, size_t S){
+    if(!a) return NULL;
+    if(S && N > (SIZE_MAX - SL_MEM_ALIGN) / S) ERRX(_("Too large memory block: %zd x %zd bytes"), N, S);
+    size_t len = MEMALIGN(N * S);
+    if(!len) len = SL_MEM_ALIGN; // return unique pointer for zero size like calloc does
+    memchunk_t *c = a->head;
+    if(c->size - c->used < len){
+        if(len > a->chunksize / 4){ // too large block: give it separate chunk behind current
+            memchunk_t *big = newchunk(len);
+            big->used = len;
+            big->next = c->next;
+            c->next = big;
+            a->used += len;
+            memset(CHUNKDATA(big), 0, len);
+            return CHUNKDATA(big);
+        }
+        c = newchunk(a->chunksize);
+        c->next = a->head;
+        a->head = c;
+    }
+    uint8_t *p = CHUNKDATA(c) + c->used;
+    c->used += len;
+    a->used += len;
+    memset(p, 0, len);
+    return p;
+}
+
+/**
+ * @brief sl_arena_strdup - copy string into arena
+ * @param a - arena
+ * @param s - string
+ * @return copy of `s` (NULL if a or s is NULL) or die
+ */
+char *sl_arena_strdup(sl_arena_t *a, const char *s){
+    if(!a || !s) return NULL;
+    size_t l = strlen(s) + 1;
+    char *d = sl_arena_alloc(a, l, 1);
+    memcpy(d, s, l);
+    return d;
+}
+
+/**
+ * @brief sl_arena_reset - free all memory allocated from arena at once (current chunk is kept for reuse)
+ * @param a - arena
+ */
+void sl_arena_reset(sl_arena_t *a){
+    if(!a) return;
+    a->head = freechunks(a->head);
+    a->used = 0;
+}
+
+/**
+ * @brief sl_arena_delete - free arena with all its memory
+ * @param a - arena
+ */
+void sl_arena_delete(sl_arena_t **a){
+    if(!a || !*a) return;
+    free(freechunks((*a)->head));
+    FREE(*a);
+}
+
+/**
+ * @brief sl_pool_new - create pool of fixed-size objects
+ * @param objsize - size of single object
+ * @param nperslab - amount of objects in each slab of pool's memory (0 - SL_DEF_POOLSLAB)
+ * @return pool or die
+ */
+sl_pool_t *sl_pool_new(size_t objsize, size_t nperslab){
+    if(!nperslab) nperslab = SL_DEF_POOLSLAB;
+    if(objsize < sizeof(void*)) objsize = sizeof(void*); // freed objects hold pointer to next free
+    objsize = MEMALIGN(objsize);
+    if(nperslab > SIZE_MAX / objsize) ERRX(_("Too large memory block: %zd x %zd bytes"), nperslab, objsize);
+    sl_pool_t *p = MALLOC(sl_pool_t, 1);
+    p->objsize = objsize;
+    p->nperslab = nperslab;
+    p->slabs = newchunk(objsize * nperslab);
+    return p;
+}
+
+/**
+ * @brief sl_pool_alloc - get zero-filled object from pool
+ * @param p - pool
+ * @return pointer aligned to SL_MEM_ALIGN (NULL if p is NULL) or die
+ */
+void *sl_pool_alloc(sl_pool_t *p){
+    if(!p) return NULL;
+    void *obj;
+    if(p->freelist){ // reuse freed object
+        obj = p->freelist;
+        p->freelist = *(void**)obj;
+    }else{ // carve new object from current slab
+        memchunk_t *c = p->slabs;
+        if(c->used == c->size){
+            c = newchunk(c->size);
+            c->next = p->slabs;
+            p->slabs = c;
+        }
+        obj = CHUNKDATA(c) + c->used;
+        c->used += p->objsize;
+    }
+    ++p->nused;
+    memset(obj, 0, p->objsize);
+    return obj;
+}
+
+/**
+ * @brief sl_pool_free - return object to pool
+ * @param p - pool
+ * @param obj - object got by `sl_pool_alloc` of the same pool
+ */
+void sl_pool_free(sl_pool_t *p, void *obj){
+    if(!p || !obj) return;
+    *(void**)obj = p->freelist;
+    p->freelist = obj;
+    --p->nused;
+}
+
+/**
+ * @brief sl_pool_reset - return all objects to pool at once (current slab is kept for reuse)
+ * @param p - pool
+ */
+void sl_pool_reset(sl_pool_t *p){
+    if(!p) return;
+    p->slabs = freechunks(p->slabs);
+    p->freelist = NULL;
+    p->nused = 0;
+}
+
+/**
+ * @brief sl_pool_delete - free pool with all its objects
+ * @param p - pool
+ */
+void sl_pool_delete(sl_pool_t **p){
+    if(!p || !*p) return;
+    free(freechunks((*p)->slabs));
+    FREE(*p);
+}
@@ -118,22 +118,22 @@ static int myatod(void *num, const char *str, sl_argtype_e t){
  * @param key (i)     - original key (short or long)
  * @param opt (i)     - returning val of getopt_long
  * @param options (i) - array of options
+ * @param shortidx (i)- hash map of `options` by short options
  * @return index in array
  */
-static int get_optind(const char *key, int opt, sl_option_t *options, void (*helpfun)(int, sl_option_t*)){
+static int get_optind(const char *key, int opt, sl_option_t *options, sl_hmap_t *shortidx, void (*helpfun)(int, sl_option_t*)){
     int oind = 0, theopt = opt;
-    sl_option_t *opts = options;
-    assert(opts);
+    assert(options);
     // `opt` should be ':' for "missed arguments", '?' for "not found" and short flag if found and checked
     if(opt == '?'){ // not found
         fprintf(stderr, _("No such parameter: `%s`\n"), key);
         helpfun(-1, options);
         return -1; // never reached until `helpfun` changed
     }else if(opt == ':') theopt = optopt; // search to show helpstring "need parameter"
-    for(oind = 0; opts->help && opts->val != theopt; oind++, opts++){
-        DBG("cmp %c and %c", theopt, opts->val);
-    }
-    if(!opts->help) return -1;
+    void *found = NULL;
+    if(!sl_hmap_geti(shortidx, theopt, &found)) return -1;
+    oind = (int)((sl_option_t*)found - options);
+    DBG("option %c have index %d", theopt, oind);
     if(opt == ':'){
         fprintf(stderr, _("Parameter `%s` needs value\n"), key);
         helpfun(oind, options);
@@ -143,6 +143,17 @@ static int get_optind(const char *key, int opt, sl_option_t *options, void (*hel
 }
 
 
+// MULT_PAR array state, so adding next item doesn't need to count previous
+// (valid only while `sl_parseargs_hf` runs: later user could empty or free array)
+typedef struct{
+    void ***paptr;      // address of user's pointer to array
+    void **arr;         // array after last change
+    size_t n;           // amount of items in it
+    size_t cap;         // its capacity (including terminating NULL)
+} multpar_t;
+SL_VEC(multpars, multpar_t)
+static multpars_t multpars = {0};
+
 /**
  * @brief get_aptr - reallocate new value in array of multiple repeating arguments
  * @arg paptr (io) - address of pointer to array (**void)
@@ -150,11 +161,18 @@ static int get_optind(const char *key, int opt, sl_option_t *options, void (*hel
  * @return pointer to new (next) value
  */
 void *get_aptr(void *paptr, sl_argtype_e type){
-    int i = 1;
-    void **aptr = *((void***)paptr);
-    if(aptr){ // there's something in array
-        void **p = aptr;
-        while(*p++) ++i;
+    void ***pp = (void***)paptr;
+    multpar_t *m = NULL;
+    for(size_t j = 0; j < multpars.len; ++j)
+        if(multpars.data[j].paptr == pp){ m = &multpars.data[j]; break; }
+    if(!m) m = multpars_push(&multpars, (multpar_t){.paptr = pp});
+    void **aptr = *pp;
+    if(!aptr || aptr != m->arr){ // new array or changed by user: count its items
+        m->n = m->cap = 0;
+        if(aptr){
+            while(aptr[m->n]) ++m->n;
+            m->cap = m->n + 1;
+        }
     }
     size_t sz = 0;
     switch(type){
@@ -181,15 +199,15 @@ void *get_aptr(void *paptr, sl_argtype_e type){
             sz = sizeof(argfn *);
         break;*/
     }
-    aptr = realloc(aptr, (i + 1) * sizeof(void*));
-    if(!aptr) ERR("realloc()");
-    *((void***)paptr) = aptr;
-    aptr[i] = NULL;
+    aptr = sl_vec_grow(aptr, &m->cap, m->n + 2, sizeof(void*));
+    *pp = m->arr = aptr;
+    size_t i = m->n++;
+    aptr[i + 1] = NULL;
     if(sz){
-        aptr[i - 1] = malloc(sz);
+        aptr[i] = malloc(sz);
     }else
-        aptr[i - 1] = &aptr[i - 1];
-    return aptr[i - 1];
+        aptr[i] = &aptr[i];
+    return aptr[i];
 }
 
 static int cmpstringp(const void *p1, const void *p2){
@@ -278,6 +296,7 @@ void sl_parseargs_hf(int *argc, char ***argv, sl_option_t *options, void (*helpf
         }
     }
     FREE(longlist); FREE(shortlist);
+    sl_hmap_t *shortidx = sl_hmap_options(options, TRUE);
 #ifdef EBUG
     DBG("Argc=%d, argv[0]=%s, argv[1]=%s, short=%s", *argc, (*argv)[0], (*argv)[1], short_options);
     for(int _ = 0; _ <= optsize; ++_) fprintf(stderr, "\tlo[%d]='%s'\n", _, long_options[_].name);
@@ -294,7 +313,7 @@ void sl_parseargs_hf(int *argc, char ***argv, sl_option_t *options, void (*helpf
         const char *curopt = (*argv)[optind];
         if((opt = getopt_long(*argc, *argv, short_options, long_options, &loptind)) == -1) break;
         DBG("search `%s`, %c(%d) = getopt_long(argc, argv, %s, long_options, &%d); optopt=%c(%d), errno=%d", curopt, opt, opt, short_options, loptind, optopt, optopt, errno);
-        if(loptind < 0 ) loptind = get_optind(curopt, opt, options, helpfun); // find short option -> need to know index of long
+        if(loptind < 0 ) loptind = get_optind(curopt, opt, options, shortidx, helpfun); // find short option -> need to know index of long
         if(loptind < 0 || loptind >= optsize) continue;
         // be careful with "-?" flag: all wrong or ambiguous flags will be interpreted as this!
         DBG("index=%d", loptind);
@@ -350,6 +369,8 @@ void sl_parseargs_hf(int *argc, char ***argv, sl_option_t *options, void (*helpf
         }
     }
     FREE(short_options); FREE(long_options);
+    sl_hmap_delete(&shortidx);
+    multpars_free(&multpars);
     *argc -= optind;
     *argv += optind;
 }
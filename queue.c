@@ -0,0 +1,322 @@
+/*
+ * This file is part of the Snippets project.
+ * Copyright 2026 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <linux/futex.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include "usefull_macros.h"
+
+// padding between fields changed by different threads
+#define CACHELINE   (64)
+
+/*
+ * Sleeping on empty/full queue (eventcount): waiter sets bit 0 of `seq`, checks queue once more
+ * and sleeps in futex while `seq` isn't changed; other side calls futex_wake only if bit 0 is set,
+ * clearing it and incrementing counter in upper bits, so only the first push/pop after waiter
+ * came does syscall and uncontended operations don't touch shared counters.
+ */
+typedef struct{
+    uint32_t seq;           // futex word: bit 0 - somebody waits, other bits - counter of wakeups
+} qevent_t;
+
+// bounded MPMC queue (D. Vyukov's algorithm): each cell has its sequence number
+typedef struct{
+    size_t seq;             // == position for free cell, == position+1 for filled one
+    void *data;
+} mpmccell_t;
+
+struct sl_mpmc{
+    mpmccell_t *cells;
+    size_t mask;            // size - 1
+    char pad0[CACHELINE];
+    size_t enqpos;          // position of next push
+    char pad1[CACHELINE];
+    size_t deqpos;          // position of next pop
+    char pad2[CACHELINE];
+    qevent_t notempty;      // pushed
+    qevent_t notfull;       // popped
+};
+
+// unbounded MPSC queue: linked list with a dummy node at the tail
+typedef struct mpscnode{
+    struct mpscnode *next;
+    void *data;
+} mpscnode_t;
+
+struct sl_mpsc{
+    mpscnode_t *head;       // last pushed node (producers)
+    char pad0[CACHELINE];
+    mpscnode_t *tail;       // dummy node, its `next` is the first item (consumer)
+    char pad1[CACHELINE];
+    qevent_t notempty;
+};
+
+// calculate time left till `end` (monotonic, ns); return FALSE if timed out
+static int timeleft(uint64_t end, struct timespec *ts){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t t = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    if(t >= end) return FALSE;
+    t = end - t;
+    ts->tv_sec = t / 1000000000ULL;
+    ts->tv_nsec = t % 1000000000ULL;
+    return TRUE;
+}
+
+// end time for `timeout` seconds (0 if timeout < 0 means forever)
+static uint64_t endtime(double timeout){
+    if(timeout < 0.) return 0;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec + (uint64_t)(timeout * 1e9);
+}
+
+// notify waiters of `e` after queue changed
+static void qevent_signal(qevent_t *e){
+    __atomic_thread_fence(__ATOMIC_SEQ_CST); // queue change should be visible before `seq` check
+    uint32_t seq = __atomic_load_n(&e->seq, __ATOMIC_RELAXED);
+    if(!(seq & 1)) return;
+    // if failed, another thread already did this
+    if(__atomic_compare_exchange_n(&e->seq, &seq, seq + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        syscall(SYS_futex, &e->seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+/**
+ * @brief qevent_wait - run `try` until it succeeds or timeout occured
+ * @param e - event to wait
+ * @param try - function trying to do push/pop, returns TRUE if succeed
+ * @param q, d - its arguments
+ * @param timeout - max waiting time, seconds (<0 - forever)
+ * @return TRUE if `try` succeed
+ */
+static int qevent_wait(qevent_t *e, int (*try)(void *q, void **d), void *q, void **d, double timeout){
+    if(try(q, d)) return TRUE;
+    uint64_t end = endtime(timeout);
+    struct timespec ts, *pts = NULL;
+    for(;;){
+        uint32_t seq = __atomic_fetch_or(&e->seq, 1, __ATOMIC_SEQ_CST) | 1;
+        if(try(q, d)) return TRUE;
+        if(end){
+            if(!timeleft(end, &ts)) return FALSE;
+            pts = &ts;
+        }
+        syscall(SYS_futex, &e->seq, FUTEX_WAIT_PRIVATE, seq, pts, NULL, 0);
+        if(try(q, d)) return TRUE;
+    }
+}
+
+/**
+ * @brief sl_mpmc_new - create bounded lock-free multi-producer/multi-consumer queue
+ * @param size - max amount of items (rounded up to power of 2)
+ * @return queue or die
+ */
+sl_mpmc_t *sl_mpmc_new(size_t size){
+    size_t s = 2;
+    while(s < size) s <<= 1;
+    sl_mpmc_t *q = MALLOC(sl_mpmc_t, 1);
+    q->cells = MALLOC(mpmccell_t, s);
+    q->mask = s - 1;
+    for(size_t i = 0; i < s; ++i) q->cells[i].seq = i;
+    return q;
+}
+
+/**
+ * @brief sl_mpmc_delete - free queue (data in it isn't freed)
+ * @param q - queue
+ */
+void sl_mpmc_delete(sl_mpmc_t **q){
+    if(!q || !*q) return;
+    FREE((*q)->cells);
+    FREE(*q);
+}
+
+static int mpmc_trypush(void *qq, void **d){
+    sl_mpmc_t *q = (sl_mpmc_t*)qq;
+    size_t pos = __atomic_load_n(&q->enqpos, __ATOMIC_RELAXED);
+    mpmccell_t *c;
+    for(;;){
+        c = &q->cells[pos & q->mask];
+        size_t seq = __atomic_load_n(&c->seq, __ATOMIC_ACQUIRE);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if(dif == 0){ // cell is free: try to occupy it
+            if(__atomic_compare_exchange_n(&q->enqpos, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        }else if(dif < 0) return FALSE; // queue is full
+        else pos = __atomic_load_n(&q->enqpos, __ATOMIC_RELAXED);
+    }
+    c->data = *d;
+    __atomic_store_n(&c->seq, pos + 1, __ATOMIC_RELEASE);
+    return TRUE;
+}
+
+static int mpmc_trypop(void *qq, void **d){
+    sl_mpmc_t *q = (sl_mpmc_t*)qq;
+    size_t pos = __atomic_load_n(&q->deqpos, __ATOMIC_RELAXED);
+    mpmccell_t *c;
+    for(;;){
+        c = &q->cells[pos & q->mask];
+        size_t seq = __atomic_load_n(&c->seq, __ATOMIC_ACQUIRE);
+        intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+        if(dif == 0){ // cell is filled: try to take it
+            if(__atomic_compare_exchange_n(&q->deqpos, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        }else if(dif < 0) return FALSE; // queue is empty
+        else pos = __atomic_load_n(&q->deqpos, __ATOMIC_RELAXED);
+    }
+    *d = c->data;
+    __atomic_store_n(&c->seq, pos + q->mask + 1, __ATOMIC_RELEASE);
+    return TRUE;
+}
+
+/**
+ * @brief sl_mpmc_push - push data into the tail of queue without waiting
+ * @param q - queue
+ * @param data - data to push (non-NULL pointer)
+ * @return FALSE if queue is full or wrong arguments
+ */
+int sl_mpmc_push(sl_mpmc_t *q, void *data){
+    if(!q || !data) return FALSE;
+    if(!mpmc_trypush(q, &data)) return FALSE;
+    qevent_signal(&q->notempty);
+    return TRUE;
+}
+
+/**
+ * @brief sl_mpmc_pop - get data from the head of queue without waiting
+ * @param q - queue
+ * @return data or NULL if queue is empty
+ */
+void *sl_mpmc_pop(sl_mpmc_t *q){
+    void *d = NULL;
+    if(!q || !mpmc_trypop(q, &d)) return NULL;
+    qevent_signal(&q->notfull);
+    return d;
+}
+
+/**
+ * @brief sl_mpmc_push_wait - push data, sleep while queue is full
+ * @param q - queue
+ * @param data - data to push (non-NULL pointer)
+ * @param timeout - max waiting time, seconds (<0 - forever)
+ * @return FALSE if timed out or wrong arguments
+ */
+int sl_mpmc_push_wait(sl_mpmc_t *q, void *data, double timeout){
+    if(!q || !data) return FALSE;
+    if(!qevent_wait(&q->notfull, mpmc_trypush, q, &data, timeout)) return FALSE;
+    qevent_signal(&q->notempty);
+    return TRUE;
+}
+
+/**
+ * @brief sl_mpmc_pop_wait - get data, sleep while queue is empty
+ * @param q - queue
+ * @param timeout - max waiting time, seconds (<0 - forever)
+ * @return data or NULL if timed out
+ */
+void *sl_mpmc_pop_wait(sl_mpmc_t *q, double timeout){
+    void *d = NULL;
+    if(!q || !qevent_wait(&q->notempty, mpmc_trypop, q, &d, timeout)) return NULL;
+    qevent_signal(&q->notfull);
+    return d;
+}
+
+/**
+ * @brief sl_mpmc_size - approximate amount of items in queue
+ * @param q - queue
+ * @return amount of items
+ */
+size_t sl_mpmc_size(sl_mpmc_t *q){
+    if(!q) return 0;
+    size_t d = __atomic_load_n(&q->deqpos, __ATOMIC_RELAXED);
+    size_t e = __atomic_load_n(&q->enqpos, __ATOMIC_RELAXED);
+    return (e > d) ? e - d : 0;
+}
+
+/**
+ * @brief sl_mpsc_new - create unbounded lock-free multi-producer/single-consumer queue
+ * @return queue or die
+ */
+sl_mpsc_t *sl_mpsc_new(){
+    sl_mpsc_t *q = MALLOC(sl_mpsc_t, 1);
+    q->head = q->tail = MALLOC(mpscnode_t, 1);
+    return q;
+}
+
+/**
+ * @brief sl_mpsc_delete - free queue with all its nodes (data isn't freed)
+ * @param q - queue
+ */
+void sl_mpsc_delete(sl_mpsc_t **q){
+    if(!q || !*q) return;
+    mpscnode_t *n = (*q)->tail;
+    while(n){
+        mpscnode_t *nxt = n->next;
+        FREE(n);
+        n = nxt;
+    }
+    FREE(*q);
+}
+
+/**
+ * @brief sl_mpsc_push - push data into the tail of queue (never blocks)
+ * @param q - queue
+ * @param data - data to push (non-NULL pointer)
+ * @return FALSE if wrong arguments
+ */
+int sl_mpsc_push(sl_mpsc_t *q, void *data){
+    if(!q || !data) return FALSE;
+    mpscnode_t *n = MALLOC(mpscnode_t, 1);
+    n->data = data;
+    mpscnode_t *prev = __atomic_exchange_n(&q->head, n, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&prev->next, n, __ATOMIC_RELEASE);
+    qevent_signal(&q->notempty);
+    return TRUE;
+}
+
+static int mpsc_trypop(void *qq, void **d){
+    sl_mpsc_t *q = (sl_mpsc_t*)qq;
+    mpscnode_t *tail = q->tail;
+    mpscnode_t *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if(!next) return FALSE; // empty or producer is between exchange and store
+    *d = next->data;
+    q->tail = next; // it's a new dummy
+    FREE(tail);
+    return TRUE;
+}
+
+/**
+ * @brief sl_mpsc_pop - get data from the head of queue without waiting (only one consumer thread allowed!)
+ * @param q - queue
+ * @return data or NULL if queue is empty
+ */
+void *sl_mpsc_pop(sl_mpsc_t *q){
+    void *d = NULL;
+    if(!q || !mpsc_trypop(q, &d)) return NULL;
+    return d;
+}
+
+/**
+ * @brief sl_mpsc_pop_wait - get data, sleep while queue is empty (only one consumer thread allowed!)
+ * @param q - queue
+ * @param timeout - max waiting time, seconds (<0 - forever)
+ * @return data or NULL if timed out
+ */
+void *sl_mpsc_pop_wait(sl_mpsc_t *q, double timeout){
+    void *d = NULL;
+    if(!q || !qevent_wait(&q->notempty, mpsc_trypop, q, &d, timeout)) return NULL;
+    return d;
+}
@@ -16,25 +16,115 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#define _GNU_SOURCE // memfd_create
 #include <pthread.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 #include "usefull_macros.h"
 
 /**
- * @brief sl_RB_new - create ringbuffer with `size` bytes
- * @param size - RB size
+ * @brief mirrormap - map the same memory twice back to back, so that [0, size) and [size, 2*size)
+ *        are the same bytes and any part of ring is contiguous
+ * @param size - size of memory (should be multiple of page size)
+ * @return pointer to memory or NULL if failed
+ */
+static uint8_t *mirrormap(size_t size){
+    uint8_t *addr = MAP_FAILED;
+    int fd = memfd_create("sl_ringbuffer", MFD_CLOEXEC);
+    if(fd < 0){
+        WARN("memfd_create()");
+        return NULL;
+    }
+    if(ftruncate(fd, (off_t)size)){
+        WARN("ftruncate()");
+        goto ret;
+    }
+    // reserve address space for both copies
+    addr = mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(addr == MAP_FAILED){
+        WARN("mmap()");
+        goto ret;
+    }
+    if(MAP_FAILED == mmap(addr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) ||
+       MAP_FAILED == mmap(addr + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0)){
+        WARN("mmap()");
+        munmap(addr, 2 * size);
+        addr = MAP_FAILED;
+    }
+ret:
+    close(fd); // mappings hold the memory
+    return (addr == MAP_FAILED) ? NULL : addr;
+}
+
+/**
+ * @brief sl_RB_new_ext - create ringbuffer with `size` bytes and given options
+ * @param size - RB size (rounded up to page size for SL_RB_MIRROR)
+ * @param flags - SL_RB_SPSC for lock-free single producer/single consumer buffer (see `sl_RB_new_spsc`),
+ *        SL_RB_MIRROR to map memory twice (if failed, usual buffer will be created)
  * @return RB
  */
-sl_ringbuffer_t *sl_RB_new(size_t size){
+sl_ringbuffer_t *sl_RB_new_ext(size_t size, int flags){
     sl_ringbuffer_t *b = MALLOC(sl_ringbuffer_t, 1);
-    b->data = MALLOC(uint8_t, size);
+    if(flags & SL_RB_MIRROR){
+        size_t pagesz = (size_t)sysconf(_SC_PAGESIZE);
+        size_t sz = (size + pagesz - 1) / pagesz * pagesz;
+        if((b->data = mirrormap(sz))){
+            b->mirrored = TRUE;
+            size = sz;
+        }else WARNX(_("Can't create mirrored ring buffer, use usual"));
+    }
+    if(!b->data) b->data = MALLOC(uint8_t, size);
     pthread_mutex_init(&b->busy, NULL);
     b->head = b->tail = 0;
     b->length = size;
+    if(flags & SL_RB_SPSC) b->spsc = TRUE;
     return b;
 }
 
+/**
+ * @brief sl_RB_new - create ringbuffer with `size` bytes
+ * @param size - RB size
+ * @return RB
+ */
+sl_ringbuffer_t *sl_RB_new(size_t size){
+    return sl_RB_new_ext(size, 0);
+}
+
+/**
+ * @brief sl_RB_new_spsc - create lock-free ringbuffer for single producer and single consumer
+ *        only one thread can write data (sl_RB_putbyte/write/writestr) and only one thread can read it
+ *        (sl_RB_hasbyte/read/readto/readline/clearbuf), so reading and writing never block each other
+ * @param size - RB size
+ * @return RB
+ */
+sl_ringbuffer_t *sl_RB_new_spsc(size_t size){
+    return sl_RB_new_ext(size, SL_RB_SPSC);
+}
+
+// lock buffer (only in MPMC mode)
+static inline void rblock(sl_ringbuffer_t *b){
+    if(!b->spsc) pthread_mutex_lock(&b->busy);
+}
+static inline void rbunlock(sl_ringbuffer_t *b){
+    if(!b->spsc) pthread_mutex_unlock(&b->busy);
+}
+
+// amount of contiguous bytes from `idx`: up to the end of buffer or of its mirror
+static inline size_t contig(sl_ringbuffer_t *b, size_t idx){
+    return (b->mirrored ? 2 * b->length : b->length) - idx;
+}
+
+// head and tail can be changed by other side in SPSC mode: acquire their values before data access
+static inline size_t ldidx(const size_t *what){
+    return __atomic_load_n(what, __ATOMIC_ACQUIRE);
+}
+// ...and release new value after
+static inline void stidx(size_t *what, size_t val){
+    __atomic_store_n(what, val, __ATOMIC_RELEASE);
+}
+
 /**
  * @brief sl_RB_delete - free ringbuffer
  * @param b - buffer to free
@@ -42,7 +132,10 @@ sl_ringbuffer_t *sl_RB_new(size_t size){
 void sl_RB_delete(sl_ringbuffer_t **b){
     if(!b || !*b) return;
     sl_ringbuffer_t *bptr = *b;
-    FREE(bptr->data);
+    if(bptr->mirrored){
+        munmap(bptr->data, 2 * bptr->length);
+        bptr->data = NULL;
+    }else FREE(bptr->data);
     *b = 0;
     FREE(bptr);
 }
@@ -53,23 +146,24 @@ void sl_RB_delete(sl_ringbuffer_t **b){
  * @return N
  */
 static size_t datalen(sl_ringbuffer_t *b){
-    if(b->tail >= b->head) return (b->tail - b->head);
-    else return (b->length - b->head + b->tail);
+    size_t head = ldidx(&b->head), tail = ldidx(&b->tail);
+    if(tail >= head) return (tail - head);
+    else return (b->length - head + tail);
 }
 
 // datalen but with blocking of RB
 size_t sl_RB_datalen(sl_ringbuffer_t *b){
-    pthread_mutex_lock(&b->busy);
+    rblock(b);
     size_t l = datalen(b);
-    pthread_mutex_unlock(&b->busy);
+    rbunlock(b);
     return l;
 }
 
 // size of free space in buffer
 size_t sl_RB_freesize(sl_ringbuffer_t *b){
-    pthread_mutex_lock(&b->busy);
+    rblock(b);
     size_t l = b->length - datalen(b) - 1;
-    pthread_mutex_unlock(&b->busy);
+    rbunlock(b);
     return l;
 }
 
@@ -80,48 +174,66 @@ size_t sl_RB_freesize(sl_ringbuffer_t *b){
  * @return index of byte, -2 if not found or -1 if no data in buffer
  */
 static ssize_t hasbyte(sl_ringbuffer_t *b, uint8_t byte){
-    if(b->head == b->tail) return -1; // no data in buffer
-    size_t startidx = b->head;
-    /*DBG("head: %zd, tail: %zd (%c %c %c %c), search %02x",
-        b->head, b->tail, b->data[startidx], b->data[startidx+1],
-        b->data[startidx+2], b->data[startidx+3], byte);*/
-    if(b->head > b->tail){
-        for(size_t found = b->head; found < b->length; ++found)
-            if(b->data[found] == byte) return found;
-        startidx = 0;
+    size_t head = b->head, tail = ldidx(&b->tail);
+    if(head == tail) return -1; // no data in buffer
+    size_t len = (tail > head) ? tail - head : b->length - head + tail;
+    // bytes [head, head+scanned) were checked by previous call and have no `byte`
+    size_t skip = (byte == b->scanbyte) ? b->scanned : 0;
+    if(skip >= len){
+        b->scanned = len;
+        return -2;
     }
-    for(size_t found = startidx; found < b->tail; ++found)
-        if(b->data[found] == byte) return found;
-    return -2;
+    size_t start = head + skip;
+    if(start >= b->length) start -= b->length;
+    size_t n = len - skip, _1st = contig(b, start);
+    if(_1st > n) _1st = n;
+    uint8_t *found = memchr(b->data + start, byte, _1st);
+    if(!found && _1st < n) found = memchr(b->data, byte, n - _1st); // wrapped part
+    b->scanbyte = byte;
+    if(!found){
+        b->scanned = len;
+        return -2;
+    }
+    size_t idx = found - b->data;
+    if(idx >= b->length) idx -= b->length; // found in mirror
+    b->scanned = (idx >= head) ? idx - head : b->length - head + idx;
+    return (ssize_t)idx;
 }
 
 // hasbyte with block
 ssize_t sl_RB_hasbyte(sl_ringbuffer_t *b, uint8_t byte){
-    pthread_mutex_lock(&b->busy);
+    rblock(b);
     size_t idx = hasbyte(b, byte);
-    pthread_mutex_unlock(&b->busy);
+    rbunlock(b);
     return idx;
 }
-// increment head or tail
-inline void incr(sl_ringbuffer_t *b, volatile size_t *what, size_t n){
-    *what += n;
-    if(*what >= b->length) *what -= b->length;
+// increment head or tail (only by its owner: consumer or producer)
+static inline void incr(sl_ringbuffer_t *b, size_t *what, size_t n){
+    size_t val = *what + n;
+    if(val >= b->length) val -= b->length;
+    stidx(what, val);
+}
+
+// move head after reading of `n` bytes
+static inline void consume(sl_ringbuffer_t *b, size_t n){
+    b->scanned = (b->scanned > n) ? b->scanned - n : 0;
+    incr(b, &b->head, n);
 }
 
 static size_t rbread(sl_ringbuffer_t *b, uint8_t *s, size_t len){
     size_t l = datalen(b);
     if(!l) return 0;
     if(l > len) l = len;
-    size_t _1st = b->length - b->head;
+    size_t _1st = contig(b, b->head);
     if(_1st > l) _1st = l;
     if(_1st > len) _1st = len;
     memcpy(s, b->data + b->head, _1st);
     if(_1st < len && l > _1st){
         memcpy(s+_1st, b->data, l - _1st);
-        incr(b, &b->head, l);
+        consume(b, l);
         return l;
     }
-    incr(b, &b->head, _1st);
+    consume(b, _1st);
     return _1st;
 }
 
@@ -133,9 +245,9 @@ static size_t rbread(sl_ringbuffer_t *b, uint8_t *s, size_t len){
  * @return amount of bytes read
  */
 size_t sl_RB_read(sl_ringbuffer_t *b, uint8_t *s, size_t len){
-    pthread_mutex_lock(&b->busy);
+    rblock(b);
     size_t got = rbread(b, s, len);
-    pthread_mutex_unlock(&b->busy);
+    rbunlock(b);
     return got;
 }
 
@@ -149,7 +261,7 @@ size_t sl_RB_read(sl_ringbuffer_t *b, uint8_t *s, size_t len){
  */
 ssize_t sl_RB_readto(sl_ringbuffer_t *b, uint8_t byte, uint8_t *s, size_t len){
     ssize_t got = 0;
-    pthread_mutex_lock(&b->busy);
+    rblock(b);
     ssize_t idx = hasbyte(b, byte);
     if(idx < 0) goto ret;
     size_t partlen = idx + 1 - b->head;
@@ -158,7 +270,7 @@ ssize_t sl_RB_readto(sl_ringbuffer_t *b, uint8_t byte, uint8_t *s, size_t len){
     if(partlen > len) got = -1;
     else got = rbread(b, s, partlen);
 ret:
-    pthread_mutex_unlock(&b->busy);
+    rbunlock(b);
     return got;
 }
 
@@ -172,7 +284,7 @@ ret:
  */
 ssize_t sl_RB_readline(sl_ringbuffer_t *b, char *s, size_t len){
     ssize_t got = 0;
-    pthread_mutex_lock(&b->busy);
+    rblock(b);
     ssize_t idx = hasbyte(b, '\n');
     if(idx < 0){
         if(idx == -1) idx = 0; // buffer is empty - return 0; else return error
@@ -189,7 +301,7 @@ ssize_t sl_RB_readline(sl_ringbuffer_t *b, char *s, size_t len){
     }
     DBG("read: '%s'", s);
 ret:
-    pthread_mutex_unlock(&b->busy);
+    rbunlock(b);
     return got;
 }
 
@@ -201,14 +313,14 @@ ret:
  */
 int sl_RB_putbyte(sl_ringbuffer_t *b, uint8_t byte){
     int rtn = FALSE;
-    pthread_mutex_lock(&b->busy);
+    rblock(b);
     size_t s = datalen(b);
     if(b->length == s + 1) goto ret;
     b->data[b->tail] = byte;
     incr(b, &b->tail, 1);
     rtn = TRUE;
 ret:
-    pthread_mutex_unlock(&b->busy);
+    rbunlock(b);
     return rtn;
 }
 
@@ -220,7 +332,7 @@ ret:
  * @return amount of bytes wrote (can be less than `len`)
  */
 size_t sl_RB_write(sl_ringbuffer_t *b, const uint8_t *str, size_t len){
-    pthread_mutex_lock(&b->busy);
+    rblock(b);
     size_t r = b->length - 1 - datalen(b); // rest length
     DBG("rest: %zd, need: %zd", r, len);
     if(len > r) len = r;
@@ -232,7 +344,7 @@ size_t sl_RB_write(sl_ringbuffer_t *b, const uint8_t *str, size_t len){
         else printf("\\x%02x", c);
     }
     green("(end)\n");*/
-    size_t _1st = b->length - b->tail;
+    size_t _1st = contig(b, b->tail);
     if(_1st > len) _1st = len;
     memcpy(b->data + b->tail, str, _1st);
     if(_1st < len){ // add another piece from start
@@ -240,19 +352,25 @@ size_t sl_RB_write(sl_ringbuffer_t *b, const uint8_t *str, size_t len){
     }
     incr(b, &b->tail, len);
 ret:
-    pthread_mutex_unlock(&b->busy);
+    rbunlock(b);
     return len;
 }
 
 /**
- * @brief sl_RB_clearbuf - reset buffer
+ * @brief sl_RB_clearbuf - reset buffer (in SPSC mode only consumer can clear it)
  * @param b - rb
   */
 void sl_RB_clearbuf(sl_ringbuffer_t *b){
-    pthread_mutex_lock(&b->busy);
+    if(b->spsc){ // consumer can't touch tail: just drop all data
+        b->scanned = 0;
+        stidx(&b->head, ldidx(&b->tail));
+        return;
+    }
+    rblock(b);
+    b->scanned = 0;
     b->head = 0;
     b->tail = 0;
-    pthread_mutex_unlock(&b->busy);
+    rbunlock(b);
 }
 
 /**
@@ -263,11 +381,11 @@ void sl_RB_clearbuf(sl_ringbuffer_t *b){
  */
 size_t sl_RB_writestr(sl_ringbuffer_t *b, char *s){
     size_t len = strlen(s);
-    pthread_mutex_lock(&b->busy);
+    rblock(b);
     size_t r = b->length - 1 - datalen(b); // rest length
     if(s[len-1] != '\n') s[len++] = '\n';
     if(len > r){ len = 0; goto ret; } // insufficient space - don't even try to write a part
-    size_t _1st = b->length - b->tail;
+    size_t _1st = contig(b, b->tail);
     if(_1st > len) _1st = len;
     memcpy(b->data + b->tail, s, _1st);
     if(_1st < len){ // add another piece from start
@@ -275,6 +393,110 @@ size_t sl_RB_writestr(sl_ringbuffer_t *b, char *s){
     }
     incr(b, &b->tail, len);
 ret:
-    pthread_mutex_unlock(&b->busy);
+    rbunlock(b);
     return len;
 }
+
+/**
+ * @brief sl_RB_peek - get readable data without copying
+ *        data stays in buffer until `sl_RB_consume`; only reader should call this
+ * @param b - rb
+ * @param iov - array for two spans: [head, end of data or buffer) and [0, tail)
+ * @return amount of non-empty spans (0 if buffer is empty)
+ */
+int sl_RB_peek(sl_ringbuffer_t *b, struct iovec iov[2]){
+    int n = 0;
+    rblock(b);
+    size_t head = b->head, l = datalen(b);
+    if(l){
+        iov[0].iov_base = b->data + head;
+        size_t _1st = contig(b, head);
+        if(_1st >= l) iov[0].iov_len = l;
+        else{
+            iov[0].iov_len = _1st;
+            iov[1].iov_base = b->data;
+            iov[1].iov_len = l - _1st;
+            n = 1;
+        }
+        ++n;
+    }
+    rbunlock(b);
+    return n;
+}
+
+/**
+ * @brief sl_RB_consume - remove `len` bytes (got by `sl_RB_peek`) from buffer
+ * @param b - rb
+ * @param len - amount of bytes
+ * @return amount of bytes removed (not more than data length)
+ */
+size_t sl_RB_consume(sl_ringbuffer_t *b, size_t len){
+    rblock(b);
+    size_t l = datalen(b);
+    if(len > l) len = l;
+    if(len) consume(b, len);
+    rbunlock(b);
+    return len;
+}
+
+/**
+ * @brief sl_RB_reserve - get free space of buffer to write data directly
+ *        written data becomes readable after `sl_RB_commit`; only writer should call this
+ * @param b - rb
+ * @param iov - array for two spans: [tail, end of buffer or head-1) and [0, head-1)
+ * @return amount of non-empty spans (0 if buffer is full)
+ */
+int sl_RB_reserve(sl_ringbuffer_t *b, struct iovec iov[2]){
+    int n = 0;
+    rblock(b);
+    size_t head = ldidx(&b->head), tail = b->tail;
+    // one byte is always free to distinguish full buffer from empty
+    size_t rest = (tail >= head) ? b->length - tail + head - 1 : head - tail - 1;
+    if(rest){
+        iov[0].iov_base = b->data + tail;
+        size_t _1st = contig(b, tail);
+        if(_1st >= rest) iov[0].iov_len = rest;
+        else{
+            iov[0].iov_len = _1st;
+            iov[1].iov_base = b->data;
+            iov[1].iov_len = rest - _1st;
+            n = 1;
+        }
+        ++n;
+    }
+    rbunlock(b);
+    return n;
+}
+
+/**
+ * @brief sl_RB_commit - make `len` bytes written into spans from `sl_RB_reserve` readable
+ * @param b - rb
+ * @param len - amount of bytes
+ * @return amount of bytes added (not more than free space)
+ */
+size_t sl_RB_commit(sl_ringbuffer_t *b, size_t len){
+    rblock(b);
+    size_t r = b->length - 1 - datalen(b);
+    if(len > r) len = r;
+    if(len) incr(b, &b->tail, len);
+    rbunlock(b);
+    return len;
+}
+
+/**
+ * @brief sl_RB_readfd - read data from `fd` directly into buffer's free space by one readv()
+ * @param b - rb
+ * @param fd - file descriptor
+ * @return amount of bytes read, 0 if EOF, -1 if error (errno == ENOBUFS if buffer is full)
+ */
+ssize_t sl_RB_readfd(sl_ringbuffer_t *b, int fd){
+    struct iovec iov[2];
+    int n = sl_RB_reserve(b, iov);
+    if(!n){
+        errno = ENOBUFS;
+        return -1;
+    }
+    ssize_t got = readv(fd, iov, n);
+    if(got > 0) sl_RB_commit(b, (size_t)got);
+    return got;
+}
@@ -0,0 +1,177 @@
+/*
+ * This file is part of the Snippets project.
+ * Copyright 2026 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "usefull_macros.h"
+
+/**
+ * @brief sl_lower_bound - find first item of sorted array which isn't less than `key`
+ * @param key - key to search
+ * @param base - array sorted in ascending order
+ * @param n - amount of items
+ * @param size - size of each item
+ * @param cmp - comparison function (like for `bsearch`: cmp(key, item) < 0 if key < item)
+ * @return index of item found or `n` if all items are less than `key`
+ */
+size_t sl_lower_bound(const void *key, const void *base, size_t n, size_t size, int (*cmp)(const void*, const void*)){
+    if(!n) return 0;
+    const char *a = (const char*)base, *b = a;
+    while(n > 1){ // answer is in [b, b+n]
+        size_t half = n / 2;
+        b = (cmp(key, b + half * size) > 0) ? b + half * size : b;
+        n -= half;
+    }
+    return (b - a) / size + (cmp(key, b) > 0);
+}
+
+/**
+ * @brief sl_upper_bound - find first item of sorted array which is greater than `key`
+ * @param key - key to search
+ * @param base - array sorted in ascending order
+ * @param n - amount of items
+ * @param size - size of each item
+ * @param cmp - comparison function (like for `bsearch`)
+ * @return index of item found or `n` if all items are less or equal to `key`
+ */
+size_t sl_upper_bound(const void *key, const void *base, size_t n, size_t size, int (*cmp)(const void*, const void*)){
+    if(!n) return 0;
+    const char *a = (const char*)base, *b = a;
+    while(n > 1){
+        size_t half = n / 2;
+        b = (cmp(key, b + half * size) >= 0) ? b + half * size : b;
+        n -= half;
+    }
+    return (b - a) / size + (cmp(key, b) >= 0);
+}
+
+// sorted index item
+typedef struct{
+    const char *key;
+    int idx;
+} sortitem_t;
+
+struct sl_sortidx{
+    sortitem_t *items;      // items sorted by key, equal keys - by index
+    size_t n;
+};
+
+static int sortitemcmp(const void *a, const void *b){
+    const sortitem_t *i1 = (const sortitem_t*)a, *i2 = (const sortitem_t*)b;
+    int r = strcmp(i1->key, i2->key);
+    if(r) return r;
+    return i1->idx - i2->idx;
+}
+
+// key for `keycmp`: not obligatory zero-terminated string
+typedef struct{
+    const char *str;
+    size_t len;
+} lenkey_t;
+
+static int keycmp(const void *k, const void *item){
+    const lenkey_t *key = (const lenkey_t*)k;
+    const char *s = ((const sortitem_t*)item)->key;
+    int r = strncmp(key->str, s, key->len);
+    if(r) return r;
+    return s[key->len] ? -1 : 0; // `s` is longer
+}
+
+/**
+ * @brief sl_sortidx_new - build sorted index of string field of array items (array isn't copied)
+ * @param base - array
+ * @param n - amount of its items
+ * @param size - size of each item
+ * @param keyoff - offset of `char*` field with key in item (e.g. offsetof(sl_option_t, name)); items with NULL key are skipped
+ * @return index or die
+ */
+sl_sortidx_t *sl_sortidx_new(const void *base, size_t n, size_t size, size_t keyoff){
+    sl_sortidx_t *x = MALLOC(sl_sortidx_t, 1);
+    if(!base || !n) return x;
+    if(n > INT_MAX) ERRX(_("Too many items for index: %zd"), n);
+    x->items = MALLOC(sortitem_t, n);
+    for(size_t i = 0; i < n; ++i){
+        const char *key = *(const char* const*)((const char*)base + i * size + keyoff);
+        if(!key) continue;
+        x->items[x->n].key = key;
+        x->items[x->n++].idx = (int)i;
+    }
+    qsort(x->items, x->n, sizeof(sortitem_t), sortitemcmp);
+    return x;
+}
+
+/**
+ * @brief sl_sortidx_options - build sorted index of options by long names
+ * @param options - array of options (ends with `end_option`)
+ * @return index or NULL if `options` is NULL
+ */
+sl_sortidx_t *sl_sortidx_options(sl_option_t *options){
+    if(!options) return NULL;
+    size_t n = 0;
+    for(sl_option_t *o = options; o->help; ++o) ++n;
+    return sl_sortidx_new(options, n, sizeof(sl_option_t), offsetof(sl_option_t, name));
+}
+
+/**
+ * @brief sl_sortidx_hitems - build sorted index of socket handlers by keys
+ * @param items - array of handlers (ends with NULL handler)
+ * @return index or NULL if `items` is NULL
+ */
+sl_sortidx_t *sl_sortidx_hitems(sl_sock_hitem_t *items){
+    if(!items) return NULL;
+    size_t n = 0;
+    for(sl_sock_hitem_t *h = items; h->handler; ++h) ++n;
+    return sl_sortidx_new(items, n, sizeof(sl_sock_hitem_t), offsetof(sl_sock_hitem_t, key));
+}
+
+/**
+ * @brief sl_sortidx_findn - find item by first `len` bytes of key
+ * @param x - index
+ * @param key - key (not obligatory zero-terminated)
+ * @param len - its length
+ * @return index of item in original array (the first of equal keys) or -1 if not found
+ */
+int sl_sortidx_findn(const sl_sortidx_t *x, const char *key, size_t len){
+    if(!x || !key || !x->n) return -1;
+    lenkey_t k = {key, len};
+    size_t i = sl_lower_bound(&k, x->items, x->n, sizeof(sortitem_t), keycmp);
+    if(i == x->n || keycmp(&k, &x->items[i])) return -1;
+    return x->items[i].idx;
+}
+
+/**
+ * @brief sl_sortidx_find - find item by key
+ * @param x - index
+ * @param key - key
+ * @return index of item in original array (the first of equal keys) or -1 if not found
+ */
+int sl_sortidx_find(const sl_sortidx_t *x, const char *key){
+    if(!key) return -1;
+    return sl_sortidx_findn(x, key, strlen(key));
+}
+
+/**
+ * @brief sl_sortidx_delete - free index (original array isn't touched)
+ * @param x - index
+ */
+void sl_sortidx_delete(sl_sortidx_t **x){
+    if(!x || !*x) return;
+    FREE((*x)->items);
+    FREE(*x);
+}
@@ -24,7 +24,10 @@
 #include <stdio.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h> // readv
 #include <sys/un.h>  // unix socket
 #include <unistd.h>
 
@@ -80,6 +83,11 @@ const char *sl_sock_hresult2str(sl_sock_hresult_e r){
     return resmessages[r];
 }
 
+static void wakeserver(sl_sock_t *s);
+static void freesrvdata(sl_sock_t *s);
+static int clientslots(sl_sock_t *s);
+static void hindex_free(struct sl_sock_hindex **x);
+
 /**
  * @brief sl_sock_delete - close socket and delete descriptor
  * @param sock - pointer to socket descriptor
@@ -87,13 +95,21 @@ const char *sl_sock_hresult2str(sl_sock_hresult_e r){
 void sl_sock_delete(sl_sock_t **sock){
     if(!sock || !*sock) return;
     sl_sock_t *ptr = *sock;
+    pthread_mutex_lock(&ptr->rmutex); // client's reader and `sl_sock_waitline` check `connected` under it
     ptr->connected = 0;
+    pthread_cond_broadcast(&ptr->rcond);
+    pthread_mutex_unlock(&ptr->rmutex);
+    wakeserver(ptr);
     if(ptr->rthread){
         DBG("Join thread");
         pthread_join(ptr->rthread, NULL);
     }
+    freesrvdata(ptr);
+    hindex_free(&ptr->hindex);
     DBG("close fd=%d", ptr->fd);
     if(ptr->fd > -1) close(ptr->fd);
+    if(ptr->evfd > -1) close(ptr->evfd);
+    if(ptr->linefd > -1) close(ptr->linefd);
     DBG("delete ring buffer");
     sl_RB_delete(&ptr->buffer);
     DBG("free addrinfo");
@@ -106,50 +122,312 @@ void sl_sock_delete(sl_sock_t **sock){
     FREE(*sock);
 }
 
+// wake up threads waiting for data in `sl_sock_waitline` (or reader waiting for free space)
+static void wakereaders(sl_sock_t *s){
+    pthread_mutex_lock(&s->rmutex);
+    pthread_cond_broadcast(&s->rcond);
+    pthread_mutex_unlock(&s->rmutex);
+}
+
+// reader thread: wait until user reads something from full buffer
+static void waitspace(sl_sock_t *s){
+    pthread_mutex_lock(&s->rmutex);
+    __atomic_store_n(&s->rbfull, TRUE, __ATOMIC_SEQ_CST);
+    while(s->connected && 0 == sl_RB_freesize(s->buffer)){
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ts.tv_nsec += 100000000; // check `connected` at least each 0.1s
+        if(ts.tv_nsec >= 1000000000){ ts.tv_nsec -= 1000000000; ++ts.tv_sec; }
+        pthread_cond_timedwait(&s->rcond, &s->rmutex, &ts);
+    }
+    __atomic_store_n(&s->rbfull, FALSE, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&s->rmutex);
+}
+
+// is there '\n' in first `n` bytes of `iov`
+static int hasnewline(struct iovec iov[2], size_t n){
+    for(int i = 0; i < 2 && n; ++i){
+        size_t l = (iov[i].iov_len < n) ? iov[i].iov_len : n;
+        if(memchr(iov[i].iov_base, '\n', l)) return TRUE;
+        n -= l;
+    }
+    return FALSE;
+}
+
+static void linefd_write(int fd){
+    uint64_t u = 1;
+    if(write(fd, &u, sizeof(u)) < 0) WARN("write()");
+}
+
+// make `linefd` readable (if it isn't yet)
+static void notifyline(sl_sock_t *s){
+    int fd = __atomic_load_n(&s->linefd, __ATOMIC_SEQ_CST);
+    if(fd < 0 || __atomic_exchange_n(&s->lineready, TRUE, __ATOMIC_SEQ_CST)) return;
+    linefd_write(fd);
+}
+
+// called by reader of buffer when there's no full lines: reset `linefd` readiness
+static void clearline(sl_sock_t *s){
+    if(!__atomic_exchange_n(&s->lineready, FALSE, __ATOMIC_SEQ_CST)) return;
+    uint64_t u;
+    if(read(s->linefd, &u, sizeof(u)) < 0 && errno != EAGAIN) WARN("read()");
+    // new line could come before reset of flag or its notification could be read just now
+    if(sl_RB_hasbyte(s->buffer, '\n') > -1 || !s->connected){
+        __atomic_store_n(&s->lineready, TRUE, __ATOMIC_SEQ_CST);
+        linefd_write(s->linefd);
+    }
+}
+
 /**
  * @brief clientrbthread - thread to fill client's ringbuffer with incoming data
- *        If s->handlers is not NULL, process all incoming data HERE, you shouldn't use ringbuffer by hands!
+ *        It sleeps in poll() until data comes or `sl_sock_delete` writes to `evfd`
  * @param d - socket descriptor
  * @return NULL
  */
 static void *clientrbthread(void *d){
     sl_sock_t *s = (sl_sock_t*) d;
-    size_t buflen = s->buffer->length;
-    char *buf = MALLOC(char, buflen);
     DBG("Start client read buffer thread");
-    while(s && s->connected){
-        pthread_mutex_lock(&s->mutex);
-        if(1 != sl_canread(s->fd)){
-            pthread_mutex_unlock(&s->mutex);
-            usleep(1000);
+    struct pollfd fds[2] = {{.fd = s->fd, .events = POLLIN}, {.fd = s->evfd, .events = POLLIN}};
+    while(s->connected){
+        if(poll(fds, 2, -1) < 0){
+            if(errno == EINTR) continue;
+            WARN("poll()");
+            break;
+        }
+        if(fds[1].revents) break; // socket is closing
+        if(!fds[0].revents) continue;
+        // buffer is SPSC: this thread is the only writer, so no lock needed
+        struct iovec iov[2];
+        int niov = sl_RB_reserve(s->buffer, iov);
+        if(!niov){
+            waitspace(s);
             continue;
         }
-        ssize_t n = read(s->fd, buf, buflen);
-        //DBG("read %zd from fd=%d, unlock", n, s->fd);
-        //DBG("buf=%s", buf);
-        pthread_mutex_unlock(&s->mutex);
-        if(n < 1){
-            WARNX(_("Server disconnected"));
-            goto errex;
-        }
-        ssize_t got = 0;
-        do{
-            ssize_t written = sl_RB_write(s->buffer, (uint8_t*)buf + got, n-got);
-            //DBG("Put %zd to buffer, got=%zd, n=%zd", written, got, n);
-            if(got > n) goto errex;
-            if(written > 0) got += written;
-        }while(got != n);
-        //DBG("All messsages done");
+        ssize_t n = readv(s->fd, iov, niov);
+        if(n > 0){
+            // check for new line only if somebody watches `linefd`
+            int gotline = (__atomic_load_n(&s->linefd, __ATOMIC_SEQ_CST) > -1) && hasnewline(iov, n);
+            sl_RB_commit(s->buffer, (size_t)n);
+            wakereaders(s);
+            if(gotline) notifyline(s);
+            continue;
+        }
+        if(n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        WARNX(_("Server disconnected"));
+        break;
     }
-errex:
-    FREE(buf);
-    s->rthread = 0;
+    // `rthread` stays valid: sl_sock_delete joins it
+    pthread_mutex_lock(&s->rmutex);
     s->connected = FALSE;
+    pthread_cond_broadcast(&s->rcond);
+    pthread_mutex_unlock(&s->rmutex);
+    notifyline(s); // let event loops of user know about disconnection
     return NULL;
 }
 
+// reference-counted message: the same data could be queued for several clients
+typedef struct{
+    int refcnt;             // amount of queues holding it
+    size_t len;             // data length
+    uint8_t data[];         // data
+} payload_t;
+
+static payload_t *payload_new(const uint8_t *data, size_t len){
+    payload_t *p = (payload_t*) sl_alloc(1, sizeof(payload_t) + len);
+    p->refcnt = 1;
+    p->len = len;
+    memcpy(p->data, data, len);
+    return p;
+}
+static void payload_ref(payload_t *p){
+    __atomic_add_fetch(&p->refcnt, 1, __ATOMIC_RELAXED);
+}
+// clients' queues are drained by different workers, so the last of them frees payload
+static void payload_unref(payload_t *p){
+    if(0 == __atomic_sub_fetch(&p->refcnt, 1, __ATOMIC_ACQ_REL)) FREE(p);
+}
+
+// max amount of messages sent by one sendmsg()
+#define OUTQ_IOVMAX     (64)
+
+// client's output queue: FIFO of payloads' parts
+typedef struct sl_sock_outq{
+    payload_t **items;      // circular array of payloads
+    size_t off;             // amount of already sent bytes of the first payload
+    int cap;                // capacity of `items`
+    int head;               // index of the first payload
+    int n;                  // amount of payloads
+    size_t bytes;           // total amount of bytes to send
+    double closeat;         // >0 - connection is closed for reading and will be closed when queue is sent
+                            // (or at this time if client doesn't take data)
+} sl_sock_outq_t;
+
+// lingering connection is closed if it didn't take any data for this time (seconds)
+#define OUTQ_LINGER     (10.)
+
+static sl_sock_outq_t *outq_new(){
+    sl_sock_outq_t *q = MALLOC(sl_sock_outq_t, 1);
+    q->cap = 16;
+    q->items = MALLOC(payload_t*, q->cap);
+    return q;
+}
+static void outq_clear(sl_sock_outq_t *q){
+    for(int i = 0; i < q->n; ++i) payload_unref(q->items[(q->head + i) % q->cap]);
+    q->head = q->n = 0;
+    q->off = 0;
+    __atomic_store_n(&q->bytes, 0, __ATOMIC_RELAXED);
+}
+static void outq_free(sl_sock_outq_t **q){
+    if(!q || !*q) return;
+    outq_clear(*q);
+    FREE((*q)->items);
+    FREE(*q);
+}
+// add payload `p` (one reference belongs to queue now) without its first `off` bytes
+// (part of message could be sent directly only when queue was empty)
+static void outq_push(sl_sock_outq_t *q, payload_t *p, size_t off){
+    if(q->n == q->cap){ // enlarge array keeping order
+        payload_t **items = MALLOC(payload_t*, q->cap * 2);
+        for(int i = 0; i < q->n; ++i) items[i] = q->items[(q->head + i) % q->cap];
+        FREE(q->items);
+        q->items = items;
+        q->head = 0;
+        q->cap *= 2;
+    }
+    if(q->n == 0) q->off = off;
+    q->items[(q->head + q->n++) % q->cap] = p;
+    __atomic_store_n(&q->bytes, q->bytes + p->len - off, __ATOMIC_RELAXED);
+}
+// remove `len` sent bytes from queue
+static void outq_consume(sl_sock_outq_t *q, size_t len){
+    __atomic_store_n(&q->bytes, q->bytes - len, __ATOMIC_RELAXED);
+    while(len && q->n){
+        payload_t *p = q->items[q->head];
+        size_t rest = p->len - q->off;
+        if(len < rest){
+            q->off += len;
+            return;
+        }
+        len -= rest;
+        payload_unref(p);
+        q->head = (q->head + 1) % q->cap;
+        --q->n;
+        q->off = 0;
+    }
+}
+
+/**
+ * @brief flushout - send as much of client's output queue as socket can take without blocking
+ *        (run with locked client's mutex)
+ * @param c - client
+ * @return FALSE if connection is broken
+ */
+static int flushout(sl_sock_t *c){
+    sl_sock_outq_t *q = c->outq;
+    struct iovec iov[OUTQ_IOVMAX];
+    while(q->n){
+        int n = (q->n < OUTQ_IOVMAX) ? q->n : OUTQ_IOVMAX;
+        for(int i = 0; i < n; ++i){
+            payload_t *p = q->items[(q->head + i) % q->cap];
+            size_t off = i ? 0 : q->off;
+            iov[i].iov_base = p->data + off;
+            iov[i].iov_len = p->len - off;
+        }
+        struct msghdr m = {.msg_iov = iov, .msg_iovlen = n};
+        ssize_t r = sendmsg(c->fd, &m, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if(r < 0){
+            if(errno == EINTR) continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK) break; // event loop will continue when socket is ready
+            return FALSE;
+        }
+        outq_consume(q, (size_t)r);
+        if(q->closeat > 0.) q->closeat = sl_dtime() + OUTQ_LINGER;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief enqueue - send message to server's client without blocking:
+ *        what can't be sent just now is stored in its output queue and sent by server's event loop
+ *        (run with locked client's mutex); queue size limits only backlog: message put into empty
+ *        queue is stored whole, so single large answer reaches even slow reader
+ * @param c - client
+ * @param msg - message
+ * @param l - its length
+ * @param shared - payload with `msg` to share between clients (or NULL to copy unsent part of `msg`)
+ * @return `l` or -1 if message was dropped or client disconnected
+ */
+static ssize_t enqueue(sl_sock_t *c, const uint8_t *msg, size_t l, payload_t *shared){
+    if(!c->connected || c->fd < 0) return -1;
+    sl_sock_outq_t *q = c->outq;
+    size_t sent = 0;
+    if(0 == q->n){ // queue is empty - try to send directly
+        while(sent < l){
+            ssize_t r = send(c->fd, msg + sent, l - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if(r < 0){
+                if(errno == EINTR) continue;
+                if(errno == EAGAIN || errno == EWOULDBLOCK) break;
+                return -1;
+            }
+            sent += r;
+        }
+    }
+    if(sent < l && q->n && q->bytes + (l - sent) > (size_t)c->outqsize){
+        // part of message already sent can't be dropped: the stream would be broken
+        if(c->oqpolicy == SOCKOQ_DROP && sent == 0){
+            DBG("Drop message for fd=%d: output queue is full", c->fd);
+            return -1;
+        }
+        WARNX(_("Output queue overflow for fd=%d, disconnect"), c->fd);
+        LOGWARN(_("Output queue overflow for fd=%d, disconnect"), c->fd);
+        shutdown(c->fd, SHUT_RDWR); // event loop will close connection
+        outq_clear(q); // and next messages will fail on send()
+        return -1;
+    }
+    if(sent < l){
+        if(shared){
+            payload_ref(shared);
+            outq_push(q, shared, sent);
+        }else outq_push(q, payload_new(msg + sent, l - sent), 0);
+    }
+    return (ssize_t)l;
+}
+
+// send message through client's output queue (see `enqueue`)
+static ssize_t queuemessage(sl_sock_t *c, const uint8_t *msg, size_t l, payload_t *shared){
+    pthread_mutex_lock(&c->mutex);
+    ssize_t ret = enqueue(c, msg, l, shared);
+    pthread_mutex_unlock(&c->mutex);
+    return ret;
+}
+
+/**
+ * @brief sendblocking - send whole message waiting while socket is full (run with locked socket's mutex)
+ * @param s - socket
+ * @param msg - message
+ * @param l - its length
+ * @return `l` or -1 in case of error
+ */
+static ssize_t sendblocking(sl_sock_t *s, const uint8_t *msg, size_t l){
+    ssize_t sent = 0;
+    do{
+        ssize_t r = send(s->fd, msg+sent, l-sent, MSG_NOSIGNAL);
+        if(r < 0){
+            if(errno == EINTR) continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK){ // nonblocking socket is full - wait a little
+                if(sl_canwrite(s->fd) > -1) continue;
+            }
+            return -1;
+        }else sent += r;
+        DBG("sent %zd bytes", r);
+    } while((size_t)sent != l);
+    return sent;
+}
+
 /**
  * @brief sl_sock_sendall - send data to all clients connected (works only for server)
+ *        data is sent without blocking; slow clients get the same shared copy of it in their output queues;
+ *        HTTP clients are skipped: unframed data would break their responses
  * @param data - message
  * @param len - its length
  * @return N of sends or -1 if no server process running
@@ -158,82 +436,20 @@ int sl_sock_sendall(sl_sock_t *sock, uint8_t *data, size_t len){
     FNAME();
     if(!sock || !sock->clients) return -1;
     int nsent = 0;
-    for(int i = sock->maxclients; i > 0; --i){
-        if(!sock->clients[i]) continue;
-        if(sock->clients[i]->fd < 0 || !sock->clients[i]->connected) continue;
-        if((ssize_t)len == sl_sock_sendbinmessage(sock->clients[i], data, len)) ++nsent;
+    payload_t *shared = NULL;
+    for(int i = clientslots(sock); i > 0; --i){
+        sl_sock_t *c = __atomic_load_n(&sock->clients[i], __ATOMIC_ACQUIRE);
+        if(!c) continue;
+        if(c->fd < 0 || !c->connected || c->http) continue;
+        if(c->outq){
+            if(!shared) shared = payload_new(data, len);
+            if((ssize_t)len == queuemessage(c, data, len, shared)) ++nsent;
+        }else if((ssize_t)len == sl_sock_sendbinmessage(c, data, len)) ++nsent;
     }
+    if(shared) payload_unref(shared);
     return nsent;
 }
 
-static sl_sock_hresult_e parse_post_data(sl_sock_t *c, char *str);
-
-// return TRUE if this is header without data (also modify c->sockmethod)
-static int iswebheader(sl_sock_t *client, char *str){
-    DBG("check header: _%s_", str);
-    const char *methods[] = {
-        [SOCKM_GET] = "GET",
-        [SOCKM_PUT] = "PUT",
-        [SOCKM_POST] = "POST",
-        [SOCKM_PATCH] = "PATCH",
-        [SOCKM_DELETE] = "DELETE"
-    };
-    const int metlengths[] = {
-        [SOCKM_GET] = 3,
-        [SOCKM_PUT] = 3,
-        [SOCKM_POST] = 4,
-        [SOCKM_PATCH] = 5,
-        [SOCKM_DELETE] = 6
-    };
-    for(sl_sockmethod_e m = SOCKM_GET; m < SOCKM_AMOUNT; ++m){
-        if(0 == strncmp(str, methods[m], metlengths[m])){
-            client->sockmethod = m;
-            DBG("SOCK method: %s", methods[m]);
-            if(m == SOCKM_GET){ // modify `str` by GET
-                char *slash = strchr(str, '/');
-                if(slash){
-                    char *eol = strstr(slash, "HTTP");
-                    if(eol){ // move to `str` head
-                        size_t l = eol - slash - 2;
-                        memmove(str, slash+1, l);
-                        str[l] = 0;
-                        DBG("User asks GET '%s' -> run parser", str);
-                        //parse_post_data(client, str);
-                        return TRUE;
-                    }
-                }
-            }
-            return TRUE;
-        }
-    }
-    return FALSE;
-}
-
-static char *stringscan(char *str, char *needle){
-    char *a, *end = str + strlen(str);
-    a = strstr(str, needle);
-    if(!a) return NULL;
-    a += strlen(needle);
-    while (a < end && isspace(*a)) a++;
-    if(a >= end) return NULL;
-    DBG("Found a needle \"%s\"", needle);
-    return a;
-}
-
-// just check for header words - if so, return TRUE
-static int chkwebreq(sl_sock_t *client, char *str){
-    if(client->contlen == 0){
-        char *cl = stringscan(str, "Content-Length:");
-        if(cl){
-            DBG("Contlen: _%s_", cl);
-            sl_str2i(&client->contlen, cl);
-            return TRUE;
-        }
-    }
-    DBG("retval: %d", !client->gotemptyline);
-    return !client->gotemptyline;
-}
-
 // In-place URL parser
 void url_decode(char *str) {
     if (!str) return;
@@ -260,7 +476,6 @@ void url_decode(char *str) {
 
 static sl_sock_hresult_e msgparser(sl_sock_t *client, char *str);
 
-// TODO: handle Content-Length correctly
 // parser of web-encoded data by POST/GET:
 static sl_sock_hresult_e parse_post_data(sl_sock_t *c, char *str){
     if (!c || !str) return RESULT_BADKEY;
@@ -291,22 +506,60 @@ static sl_sock_hresult_e parse_post_data(sl_sock_t *c, char *str){
     return RESULT_SILENCE;
 }
 
+// hash index of handlers' keys (built once when socket starts)
+typedef struct sl_sock_hindex{
+    sl_sock_hitem_t *items; // indexed array of handlers
+    sl_hmap_t *map;         // key -> item
+} sl_sock_hindex_t;
+
+/**
+ * @brief hindex_new - build hash index for handlers' array
+ * @param items - array of handlers (ends with NULL handler)
+ * @return index or NULL if `items` is empty
+ */
+static sl_sock_hindex_t *hindex_new(sl_sock_hitem_t *items){
+    sl_hmap_t *map = sl_hmap_hitems(items);
+    if(!map) return NULL;
+    sl_sock_hindex_t *x = MALLOC(sl_sock_hindex_t, 1);
+    x->items = items;
+    x->map = map;
+    return x;
+}
+
+static void hindex_free(sl_sock_hindex_t **x){
+    if(!x || !*x) return;
+    sl_hmap_delete(&(*x)->map);
+    FREE(*x);
+}
+
+/**
+ * @brief findhandler - find handler by key
+ * @param client - client (or server)
+ * @param key - key (not obligatory zero-terminated)
+ * @param len - key length
+ * @return handler or NULL if not found
+ */
+static sl_sock_hitem_t *findhandler(sl_sock_t *client, const char *key, size_t len){
+    sl_sock_hindex_t *x = client->hindex;
+    if(x && x->items == client->handlers){
+        void *h = NULL;
+        sl_hmap_getn(x->map, key, len, &h);
+        return (sl_sock_hitem_t*)h;
+    }
+    // handlers were changed after start: linear search
+    for(sl_sock_hitem_t *h = client->handlers; h->handler; ++h)
+        if(h->key && 0 == strncmp(h->key, key, len) && h->key[len] == 0) return h;
+    return NULL;
+}
+
 // parser of client's message
 // "only-server's" fields of `client` are copies of server's
+// serialize handlers with `sl_sock_keyno_t` data: key number is stored in common structure
+static pthread_mutex_t keyno_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 static sl_sock_hresult_e msgparser(sl_sock_t *client, char *str){
     char key[SL_KEY_LEN], val[SL_VAL_LEN], *valptr;
     if(!str || !*str) return RESULT_BADKEY;
-    // check web headers and fields
-    DBG("\n\nLINENO: %lu", client->lineno);
-    if(client->lineno == 0){ // first data line from client -> check if it's a header
-        if(iswebheader(client, str)){
-            if(client->sockmethod == SOCKM_GET)
-                return parse_post_data(client, str);
-            return RESULT_SILENCE;
-        }
-    }else if(client->sockmethod != SOCKM_RAW){
-        if(chkwebreq(client, str)) return RESULT_SILENCE;
-    }
     if(!client->handlers){ // have only default handler
         if(!client->defmsg_handler) return RESULT_BADKEY;
         return client->defmsg_handler(client, str);
@@ -333,16 +586,22 @@ static sl_sock_hresult_e msgparser(sl_sock_t *client, char *str){
         return RESULT_SILENCE;
     }
     // check for strict params like `key=val`
-    for(sl_sock_hitem_t *h = client->handlers; h->handler; ++h){
-        if(strcmp(h->key, key)) continue;
+    int keylen = strlen(key);
+    sl_sock_hitem_t *h = findhandler(client, key, keylen);
+    if(h){
         if(h->data){
             sl_sock_keyno_t *kn = (sl_sock_keyno_t*)h->data;
-            if(-1 == isinf(kn->magick)) kn->n = -1; // no value number
+            if(-1 == isinf(kn->magick)){
+                pthread_mutex_lock(&keyno_mutex);
+                kn->n = -1; // no value number
+                sl_sock_hresult_e r = h->handler(client, h, valptr);
+                pthread_mutex_unlock(&keyno_mutex);
+                return r;
+            }
         }
         return h->handler(client, h, valptr);
     }
     // now check for optional key's number like key0=val, key[1]=val, key(2)=val or key{3}=val
-    int keylen = strlen(key);
     char *numstart = NULL;
     const char *bra = "([{", *ket = ")]}";
     char *found = strchr((char*)ket, key[keylen - 1]);
@@ -367,47 +626,438 @@ static sl_sock_hresult_e msgparser(sl_sock_t *client, char *str){
         char *eptr;
         long long LL = strtoll(numstart, &eptr, 0);
         DBG("LL=%lld, len=%d", LL, keylen);
-        if(eptr != numstart && LL >= 0 && LL <= INT_MAX){
-            int parno = (int)LL;
-            for(sl_sock_hitem_t *h = client->handlers; h->handler; ++h){
-                if(strncmp(h->key, key, keylen)) continue; // now search only in first `keylen` bytes
-                DBG("found %s", h->key);
-                if(h->data){
-                    sl_sock_keyno_t *kn = (sl_sock_keyno_t*)h->data;
-                    if(-1 == isinf(kn->magick)){
-                        kn->n = parno;
-                        DBG("run handler, parno=%d", parno);
-                        return h->handler(client, h, valptr);
-                    }
+        if(eptr != numstart && LL >= 0 && LL <= INT_MAX && (h = findhandler(client, key, keylen))){
+            DBG("found %s", h->key);
+            if(h->data){
+                sl_sock_keyno_t *kn = (sl_sock_keyno_t*)h->data;
+                if(-1 == isinf(kn->magick)){
+                    DBG("run handler, parno=%lld", LL);
+                    // `kn` is shared between all workers of server's pool
+                    pthread_mutex_lock(&keyno_mutex);
+                    kn->n = (int)LL;
+                    sl_sock_hresult_e r = h->handler(client, h, valptr);
+                    pthread_mutex_unlock(&keyno_mutex);
+                    return r;
                 }
-                DBG("NO data");
-                break;
             }
+            DBG("NO data");
         }
     }
     if(client->defmsg_handler) return client->defmsg_handler(client, str);
     return RESULT_BADKEY;
 }
 
-// send http responce with data in c->outbuffer
-static void send_http_response(sl_sock_t* c){
-    if(c->sockmethod == SOCKM_RAW) return;
+// the longest reason phrase of `httpstatus`
+#define HTTP_LONGREASON "Request Header Fields Too Large"
+
+// reason phrase of HTTP status
+static const char *httpstatus(int code){
+    switch(code){
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 413: return "Content Too Large";
+        case 431: return HTTP_LONGREASON;
+        case 501: return "Not Implemented";
+        default: return "Internal Server Error";
+    }
+}
+
+// space reserved before HTTP response body for its header
+#define HTTP_HDRSPACE   (512)
+// response buffer larger than this is freed after sending
+#define HTTP_KEEPBUF    (4*BUFSIZ)
+// HTTP response header: status code and reason, "Connection" value and body length
+#define HTTP_HDRFMT     "HTTP/1.1 %d %s\r\n" \
+                        "Access-Control-Allow-Origin: *\r\n" \
+                        "Access-Control-Allow-Methods: GET, POST\r\n" \
+                        "Access-Control-Allow-Credentials: true\r\n" \
+                        "Connection: %s\r\n" \
+                        "Content-type: text/plain\r\nContent-Length: %zu\r\n\r\n"
+// 3-digit code, the longest reason, "keep-alive" and 20 digits of length always fit
+_Static_assert(sizeof(HTTP_HDRFMT) + sizeof(HTTP_LONGREASON) + sizeof("keep-alive") + 20 < HTTP_HDRSPACE,
+               "HTTP_HDRSPACE is too small for response header");
+
+/**
+ * @brief outbuf_add - append data to HTTP response body (buffer grows as needed)
+ *        run with locked client's mutex: other threads could send data to client too
+ * @param c - client
+ * @param data - data
+ * @param l - its length
+ */
+static void outbuf_add(sl_sock_t *c, const uint8_t *data, size_t l){
+    c->outbuffer = (char*) sl_vec_grow(c->outbuffer, &c->outbufsz, HTTP_HDRSPACE + c->outplen + l, 1);
+    memcpy(c->outbuffer + HTTP_HDRSPACE + c->outplen, data, l);
+    c->outplen += l;
+}
+
+/**
+ * @brief send_http_response - send HTTP response with data collected in c->outbuffer
+ *        (header is put just before data, so they are sent by one call without copying of data
+ *        and not waiting for ACK of the first part in keep-alive connection)
+ * @param c - client
+ * @param code - status code
+ * @param keepalive - FALSE if connection will be closed after response
+ */
+static void send_http_response(sl_sock_t* c, int code, int keepalive){
     DBG("Send to client HTTP response");
-    c->sockmethod = SOCKM_RAW; // dirty hack to send data by sl_sock_sendbinmessage
-    char tbuf[BUFSIZ];
-    ssize_t L = snprintf(tbuf, BUFSIZ-1,
-         "HTTP/2.0 200 OK\r\n"
-         "Access-Control-Allow-Origin: *\r\n"
-         "Access-Control-Allow-Methods: GET, POST\r\n"
-         "Access-Control-Allow-Credentials: true\r\n"
-         "Content-type: text/plain\r\nContent-Length: %zd\r\n\r\n", c->outplen);
-    if(L < 0){
-        WARN("sprintf()");
-        LOGWARN("sprintf()");
+    // hold mutex until response is sent or queued: nothing should be sent before or inside it
+    pthread_mutex_lock(&c->mutex);
+    if(!c->outbuffer) c->outbuffer = (char*) sl_vec_grow(NULL, &c->outbufsz, HTTP_HDRSPACE, 1);
+    char hdr[HTTP_HDRSPACE];
+    int L = snprintf(hdr, HTTP_HDRSPACE, HTTP_HDRFMT, code, httpstatus(code),
+                     keepalive ? "keep-alive" : "close", c->outplen);
+    char *resp = c->outbuffer + HTTP_HDRSPACE - L;
+    memcpy(resp, hdr, L);
+    size_t len = c->outplen + L;
+    if(c->outq) enqueue(c, (uint8_t*)resp, len, NULL);
+    else if(c->connected) sendblocking(c, (uint8_t*)resp, len);
+    c->sockmethod = SOCKM_RAW; // now data will be sent directly
+    c->outplen = 0;
+    if(c->outbufsz > HTTP_KEEPBUF){ // don't hold memory of large response
+        FREE(c->outbuffer);
+        c->outbufsz = 0;
+    }
+    pthread_mutex_unlock(&c->mutex);
+}
+
+SL_VEC(intvec, int)
+
+// epoll server's worker thread
+typedef struct{
+    sl_sock_t *server;      // server
+    int listenfd;           // listening socket: own (SO_REUSEPORT) or server's
+    pthread_t thread;       // thread (the first worker runs in server's `rthread`)
+    intvec_t linger;        // slots of worker's lingering clients (to close them by timeout)
+} sockworker_t;
+
+// server's internal data: clients' slots and event loop workers
+typedef struct sl_sock_srvdata{
+    pthread_mutex_t mutex;  // slots' mutex
+    sl_pool_t *pool;        // memory of clients' records
+    int nslots;             // amount of allocated records (indexes 1..nslots of `clients`)
+    int maxslots;           // size of `clients` (without zeroth item); `maxclients` could be changed later
+    intvec_t freeidx;       // stack of free clients' indexes
+    int nclients;           // amount of connected clients
+    int nworkers;           // amount of workers
+    sockworker_t *workers;  // workers' data
+} sl_sock_srvdata_t;
+
+// client's record and its address
+typedef struct{
+    sl_sock_t sock;
+    struct addrinfo ai;
+    struct sockaddr addr;
+} clrec_t;
+
+// amount of clients' records allocated at once
+#define CLIENTS_PERSLAB     (8)
+
+// wake up all server's threads sleeping in epoll_wait()
+static void wakeserver(sl_sock_t *s){
+    if(s->evfd < 0) return;
+    uint64_t u = 1;
+    if(write(s->evfd, &u, sizeof(u)) < 0) WARN("write()");
+}
+
+// allocate new client's record (under slots' mutex)
+static sl_sock_t *newclient(sl_sock_t *s){
+    clrec_t *r = POOL_ALLOC(s->srvdata->pool, clrec_t);
+    sl_sock_t *c = &r->sock;
+    c->fd = -1;
+    c->evfd = -1;
+    c->linefd = -1;
+    c->type = s->type;
+    // server's strings: they aren't freed with client
+    c->node = s->node;
+    c->service = s->service;
+    c->addrinfo = &r->ai;
+    c->addrinfo->ai_addr = &r->addr;
+    pthread_mutex_init(&c->mutex, NULL);
+    return c;
+}
+
+/**
+ * @brief getslot - get free client's slot: the last freed one or new (its record is allocated here)
+ *        client's index is stable while it is connected; records are reused by next clients
+ * @param s - server
+ * @return slot index (1..maxclients) or -1 if maxclients are connected
+ */
+static int getslot(sl_sock_t *s){
+    sl_sock_srvdata_t *d = s->srvdata;
+    int idx = -1;
+    pthread_mutex_lock(&d->mutex);
+    if(d->nclients < s->maxclients && (d->freeidx.len || d->nslots < d->maxslots)){
+        if(d->freeidx.len) idx = d->freeidx.data[--d->freeidx.len];
+        else{
+            idx = d->nslots + 1;
+            // `sl_sock_sendall` reads `clients` without lock: publish record before `nslots`
+            __atomic_store_n(&s->clients[idx], newclient(s), __ATOMIC_RELEASE);
+            __atomic_store_n(&d->nslots, idx, __ATOMIC_RELEASE);
+        }
+        ++d->nclients;
+    }
+    pthread_mutex_unlock(&d->mutex);
+    return idx;
+}
+
+// return client's slot to free stack
+static void putslot(sl_sock_t *s, int idx){
+    sl_sock_srvdata_t *d = s->srvdata;
+    pthread_mutex_lock(&d->mutex);
+    intvec_push(&d->freeidx, idx);
+    --d->nclients;
+    pthread_mutex_unlock(&d->mutex);
+}
+
+// amount of clients' records (they have indexes 1..N)
+static int clientslots(sl_sock_t *s){
+    if(!s->srvdata) return 0;
+    return __atomic_load_n(&s->srvdata->nslots, __ATOMIC_ACQUIRE);
+}
+
+// close all clients and free their buffers (records themselves are freed with server's data)
+static void freeclients(sl_sock_t *s){
+    sl_sock_t **clients = s->clients;
+    if(!clients) return;
+    for(int i = clientslots(s); i > 0; --i){
+        DBG("Clear %dth client data", i);
+        sl_sock_t *c = clients[i];
+        c->connected = 0;
+        if(c->fd > -1) close(c->fd);
+        c->fd = -1;
+        if(c->buffer) sl_RB_delete(&c->buffer);
+        outq_free(&c->outq);
+        FREE(c->http);
+        FREE(c->outbuffer);
+        c->outbufsz = 0;
+    }
+}
+
+/**
+ * @brief initclient - fill client's record by just accepted connection
+ * @param s - server
+ * @param c - client's record
+ * @param fd - client's file descriptor
+ * @param a - its address
+ * @param len - length of `a`
+ * @return FALSE if client was rejected by `newconnect_handler`
+ */
+static int initclient(sl_sock_t *s, sl_sock_t *c, int fd, struct sockaddr *a, socklen_t len){
+    c->fd = fd;
+    // server's handlers could be changed after start
+    c->handlers = s->handlers;
+    c->hindex = s->hindex;
+    c->defmsg_handler = s->defmsg_handler;
+    memcpy(c->addrinfo->ai_addr, a, len);
+    c->connected = 1;
+    struct sockaddr_in* inaddr = (struct sockaddr_in*)a;
+    if(!inet_ntop(AF_INET, &inaddr->sin_addr, c->IP, INET_ADDRSTRLEN)){
+        WARN("inet_ntop()");
+        *c->IP = 0;
+    }
+    DBG("got IP:%s", c->IP);
+    // output queue is ready before `newconnect_handler`: it could send greeting
+    c->oqpolicy = s->oqpolicy;
+    c->outqsize = s->outqsize;
+    if(!c->outq && s->outqsize > 0) c->outq = outq_new(); // protected by client's mutex
+    if(s->newconnect_handler && s->newconnect_handler(c) == FALSE){
+        DBG("Client %s rejected", c->IP);
+        return FALSE;
+    }
+    if(!c->buffer){ // allocate memory for client's ringbuffer
+        DBG("allocate ringbuffer");
+        // the same size as for master; it's filled and parsed by the same server's thread
+        c->buffer = sl_RB_new_spsc(s->buffer->length);
+    }
+    return TRUE;
+}
+
+/**
+ * @brief closeclient - close client's connection and clear its record for next usage
+ * @param s - server
+ * @param c - client
+ */
+static void closeclient(sl_sock_t *s, sl_sock_t *c){
+    DBG("Disconnect client \"%s\" (fd=%d)", c->IP, c->fd);
+    if(s->disconnect_handler) s->disconnect_handler(c);
+    pthread_mutex_lock(&c->mutex);
+    if(c->outq){ // last try to send rest of data; slow client will lose it
+        flushout(c);
+        outq_clear(c->outq);
+        c->outq->closeat = 0.;
+    }
+    DBG("close fd %d", c->fd);
+    c->connected = 0;
+    close(c->fd);
+    c->fd = -1;
+    c->outplen = 0;
+    c->lineno = 0;
+    c->sockmethod = SOCKM_RAW;
+    FREE(c->http);
+    if(c->buffer) sl_RB_clearbuf(c->buffer);
+    pthread_mutex_unlock(&c->mutex);
+}
+
+// get all client's data as contiguous block (copy it to `buf` if it wraps around the end of ring buffer)
+static char *peekdata(sl_sock_t *c, uint8_t *buf, size_t bufsize, size_t *len){
+    struct iovec iov[2];
+    int n = sl_RB_peek(c->buffer, iov);
+    *len = 0;
+    if(n == 0) return (char*)buf;
+    *len = iov[0].iov_len;
+    if(n == 1) return (char*)iov[0].iov_base;
+    *len += iov[1].iov_len;
+    if(*len > bufsize) *len = bufsize; // can't be: `buf` isn't less than ring buffer
+    memcpy(buf, iov[0].iov_base, iov[0].iov_len);
+    memcpy(buf + iov[0].iov_len, iov[1].iov_base, *len - iov[0].iov_len);
+    return (char*)buf;
+}
+
+// check if the first line of client's data is HTTP request line; return FALSE if it isn't full yet or isn't request
+static int ishttp(sl_sock_t *c, uint8_t *buf, size_t bufsize){
+    size_t len;
+    char *data = peekdata(c, buf, bufsize, &len);
+    char *eol = memchr(data, '\n', len);
+    if(!eol) return FALSE;
+    char *sp = memchr(data, ' ', eol - data); // any method: unknown ones get "501 Not Implemented"
+    if(!sp || sp == data) return FALSE;
+    size_t l = eol - sp;
+    return l > 9 && 0 == strncmp(eol - ((eol[-1] == '\r') ? 9 : 8), "HTTP/1.", 7);
+}
+
+// run handlers for request and send response
+static void httprequest(sl_sock_t *c, uint8_t *buf, size_t bufsize){
+    sl_httpreq_t *r = c->http;
+    if(r->method == SOCKM_RAW){
+        send_http_response(c, 501, r->keepalive);
         return;
     }
-    if(L != sl_sock_sendbinmessage(c, (uint8_t*)tbuf, L)) return;
-    if(c->outplen != (size_t)sl_sock_sendbinmessage(c, (uint8_t*)c->outbuffer, c->outplen)) return;
+    pthread_mutex_lock(&c->mutex); // `sockmethod` is checked by senders from other threads
+    c->sockmethod = r->method; // collect answer in `outbuffer`
+    pthread_mutex_unlock(&c->mutex);
+    // GET has data in target: "/key=val&key1=val1", other methods - in body
+    sl_strslice_t data = (r->method == SOCKM_GET) ? r->target : r->body;
+    if(r->method == SOCKM_GET && data.len && *data.ptr == '/'){ ++data.ptr; --data.len; }
+    if(data.len >= bufsize) data.len = bufsize - 1; // can't be: request is in ring buffer
+    if(data.len){ // parser modifies data, so copy it into zero-terminated buffer
+        memmove(buf, data.ptr, data.len);
+        buf[data.len] = 0;
+        parse_post_data(c, (char*)buf);
+    }
+    send_http_response(c, 200, r->keepalive);
+}
+
+// TRUE if client's output queue isn't empty
+static int outq_busy(sl_sock_t *c){
+    return c->outq && __atomic_load_n(&c->outq->bytes, __ATOMIC_RELAXED);
+}
+
+// process all complete HTTP requests (pipelining is allowed); return FALSE to close connection
+// next request waits until previous response leaves output queue: so each response comes into
+// empty queue and is stored whole (event loop continues parsing when queue is sent)
+static int parsehttp(sl_sock_t *c, uint8_t *buf, size_t bufsize){
+    sl_httpreq_t *r = c->http;
+    while(c->connected && !outq_busy(c)){
+        size_t len;
+        char *data = peekdata(c, buf, bufsize, &len);
+        if(!len) return TRUE;
+        sl_httpstate_e st = sl_http_parse(r, data, len);
+        if(st == SL_HTTP_ERROR){
+            send_http_response(c, 400, FALSE);
+            sl_RB_clearbuf(c->buffer); // nothing is answered after error
+            return FALSE;
+        }
+        if(st != SL_HTTP_DONE){
+            if(sl_RB_freesize(c->buffer) == 0){ // request is larger than buffer
+                send_http_response(c, (st == SL_HTTP_HEAD) ? 431 : 413, FALSE);
+                sl_RB_clearbuf(c->buffer);
+                return FALSE;
+            }
+            if(r->expectcont && st != SL_HTTP_HEAD){
+                r->expectcont = FALSE;
+                sl_sock_sendstrmessage(c, "HTTP/1.1 100 Continue\r\n\r\n"); // interim response has no headers
+            }
+            return TRUE;
+        }
+        DBG("Request with len %zd, target `%.*s`, body %zd bytes", r->reqlen, (int)r->target.len, r->target.ptr, r->body.len);
+        int keepalive = r->keepalive;
+        httprequest(c, buf, bufsize);
+        sl_RB_consume(c->buffer, r->reqlen);
+        sl_http_init(r);
+        ++c->lineno;
+        if(!keepalive){ // it was the last request
+            sl_RB_clearbuf(c->buffer);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * @brief parseclient - process all full lines (or HTTP requests) from client's ringbuffer
+ * @param c - client
+ * @param buf - temporary buffer
+ * @param bufsize - its size
+ * @return FALSE if client should be disconnected
+ */
+static int parseclient(sl_sock_t *c, uint8_t *buf, size_t bufsize){
+    if(c->lineno == 0 && !c->http && ishttp(c, buf, bufsize)){ // first line of HTTP client
+        c->http = MALLOC(sl_httpreq_t, 1);
+        sl_http_init(c->http);
+    }
+    if(c->http) return parsehttp(c, buf, bufsize);
+    while(c->connected){
+        ssize_t got = sl_RB_readline(c->buffer, (char*)buf, bufsize);
+        if(got < 0){ // buffer overflow
+            WARNX(_("Server thread: buffer overflow from fd=%d"), c->fd);
+            return FALSE;
+        }else if(got == 0) return TRUE;
+        if(got > 1 && *buf && *buf != '\r'){ // not empty line
+            if(buf[got-2] == '\r'){
+                buf[got-2] = 0; // omit '\r' for "\r\n"
+                DBG("delete \\r: _%s_", buf);
+            }
+            sl_sock_hresult_e r = msgparser(c, (char*)buf);
+            if(r != RESULT_SILENCE) sl_sock_sendstrmessage(c, sl_sock_hresult2str(r));
+        }else DBG("EMPTY line");
+        ++c->lineno;
+    }
+    return TRUE;
+}
+
+// TRUE if client is closed for reading and waits until its output queue is sent
+static int lingering(sl_sock_t *c){
+    return c->outq && c->outq->closeat > 0.;
+}
+
+/**
+ * @brief lingerclient - close client gracefully: stop reading, answer requests left in its buffer
+ *        and keep connection while output queue isn't sent (e.g. large response before `Connection: close`)
+ * @param c - client
+ * @param buf - temporary buffer
+ * @param bufsize - its size
+ * @return TRUE if connection stays lingering, FALSE if it should be closed now
+ */
+static int lingerclient(sl_sock_t *c, uint8_t *buf, size_t bufsize){
+    if(!c->outq || !c->connected) return FALSE; // without queue all data is already sent
+    if(!parseclient(c, buf, bufsize)) sl_RB_clearbuf(c->buffer);
+    if(!outq_busy(c)) return FALSE;
+    if(!lingering(c)){
+        DBG("Client fd=%d is lingering", c->fd);
+        shutdown(c->fd, SHUT_RD);
+        c->outq->closeat = sl_dtime() + OUTQ_LINGER;
+    }
+    return TRUE;
+}
+
+// close client polled by `pfd[i]` and put the last polled client to its place
+static void polldisconnect(sl_sock_t *s, struct pollfd *pfd, int *cidx, int *nfd, int i){
+    closeclient(s, s->clients[cidx[i]]);
+    putslot(s, cidx[i]);
+    if(i != --*nfd){
+        pfd[i] = pfd[*nfd];
+        cidx[i] = cidx[*nfd];
+    }
 }
 
 /**
@@ -417,204 +1067,413 @@ static void send_http_response(sl_sock_t* c){
  */
 static void *serverthread(void _U_ *d){
     sl_sock_t *s = (sl_sock_t*) d;
-    if(!s || (!s->handlers && !s->defmsg_handler)){
+    if(!s || !s->srvdata || (!s->handlers && !s->defmsg_handler)){
         WARNX(_("Can't start server handlers thread"));
         goto errex;
     }
     int sockfd = s->fd;
-    if(listen(sockfd, s->maxclients) == -1){
-        WARN("listen");
-        goto errex;
-    }
     DBG("Start server handlers thread");
     int nfd = 1; // only one socket @start
-    struct pollfd *poll_set = MALLOC(struct pollfd, s->maxclients+1);
-    sl_sock_t **clients = MALLOC(sl_sock_t*, s->maxclients+1);
-    s->clients = clients;
-    // init default clients records
-    for(int i = s->maxclients; i > 0; --i){
-        DBG("fill %dth client info", i);
-        clients[i] = MALLOC(sl_sock_t, 1);
-        sl_sock_t *c = clients[i];
-        c->type = s->type;
-        if(s->node) c->node = strdup(s->node);
-        if(s->service) c->service = strdup(s->service);
-        // fill addrinfo
-        c->addrinfo = MALLOC(struct addrinfo, 1);
-        c->addrinfo->ai_addr = MALLOC(struct sockaddr, 1);
-        // copy server data: we have no `self`, so use so
-        c->handlers = s->handlers;
-        c->defmsg_handler = s->defmsg_handler;
-    }
+    struct pollfd *poll_set = MALLOC(struct pollfd, s->srvdata->maxslots+1);
+    int *cidx = MALLOC(int, s->srvdata->maxslots+1); // clients' indexes for `poll_set` items
+    sl_sock_t **clients = s->clients;
     // ZERO - listening server socket
     poll_set[0].fd = sockfd;
     poll_set[0].events = POLLIN;
-    // disconnect client (no way to make this function non-nested)
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wpedantic"
-    void disconnect_(sl_sock_t *c, int N){
-        DBG("Disconnect client \"%s\" (fd=%d)", c->IP, c->fd);
-        if(s->disconnect_handler) s->disconnect_handler(c);
-        if(c->sockmethod != SOCKM_RAW) send_http_response(c); // we are closing HTTP request - send headers and answer
-        pthread_mutex_lock(&c->mutex);
-        DBG("close fd %d", c->fd);
-        c->connected = 0;
-        close(c->fd);
-        c->outplen = 0;
-        c->lineno = 0;
-        c->gotemptyline = 0;
-        sl_RB_clearbuf(c->buffer);
-        DBG("unlock fd=%d", c->fd);
-        pthread_mutex_unlock(&c->mutex);
-        // now move all data of last client to disconnected
-        if(nfd > 2 && N != nfd - 1){ // don't move the only or the last
-            DBG("lock fd=%d", clients[nfd-1]->fd);
-            pthread_mutex_lock(&clients[nfd-1]->mutex);
-            clients[N] = clients[nfd-1];
-            clients[nfd-1] = c;
-            DBG("unlock fd=%d", clients[N]->fd);
-            pthread_mutex_unlock(&clients[N]->mutex); // now N is nfd-1
-            poll_set[N] = poll_set[nfd - 1];
-        }
-        --nfd;
-    }
-#pragma GCC diagnostic pop
     // allocate buffer with size not less than RB size
     size_t bufsize = s->buffer->length; // as RB should be 1 byte less, this is OK
     uint8_t *buf = MALLOC(uint8_t, bufsize);
     while(s && s->connected){
+        for(int fdidx = 1; fdidx < nfd; ++fdidx){ // wait for possibility to write only if have data to send
+            sl_sock_t *c = clients[cidx[fdidx]];
+            if(!outq_busy(c)) poll_set[fdidx].events = lingering(c) ? 0 : POLLIN;
+            else // HTTP client doesn't send next requests until response is sent, lingering one isn't read
+                poll_set[fdidx].events = (c->http || lingering(c)) ? POLLOUT : POLLIN | POLLOUT;
+        }
         poll(poll_set, nfd, 1);
         if(poll_set[0].revents & POLLIN){ // check main for accept()
             struct sockaddr a;
             socklen_t len = sizeof(struct sockaddr);
             int client = accept(sockfd, &a, &len);
             DBG("New connection, nfd=%d, len=%d", nfd, len);
-            if(nfd == s->maxclients + 1){
+            int idx;
+            if(client < 0){
+                if(errno != EAGAIN && errno != EWOULDBLOCK) WARN("accept()");
+            }else if((idx = getslot(s)) < 0){
                 WARNX(_("Limit of connections reached"));
                 if(s->toomuch_handler) s->toomuch_handler(client);
                 close(client);
             }else{
-                memset(&poll_set[nfd], 0, sizeof(struct pollfd));
-                poll_set[nfd].fd = client;
-                poll_set[nfd].events = POLLIN;
-                DBG("got client[%d], fd=%d", nfd, client);
-                sl_sock_t *c = clients[nfd];
-                c->fd = client;
-                DBG("memcpy");
-                memcpy(c->addrinfo->ai_addr, &a, len);
-                DBG("set conn flag");
-                c->connected = 1;
-                struct sockaddr_in* inaddr = (struct sockaddr_in*)&a;
-                if(!inet_ntop(AF_INET, &inaddr->sin_addr, c->IP, INET_ADDRSTRLEN)){
-                    WARN("inet_ntop()");
-                    *c->IP = 0;
-                }
-                DBG("got IP:%s", c->IP);
-                ++nfd;
-                if(s->newconnect_handler && s->newconnect_handler(c) == FALSE){
-                    DBG("Client %s rejected", c->IP);
-                    disconnect_(c, nfd);
+                DBG("got client[%d], fd=%d", idx, client);
+                sl_sock_t *c = clients[idx];
+                if(initclient(s, c, client, &a, len)){
+                    memset(&poll_set[nfd], 0, sizeof(struct pollfd));
+                    poll_set[nfd].fd = client;
+                    poll_set[nfd].events = POLLIN;
+                    cidx[nfd++] = idx;
                 }else{
-                    if(!c->buffer){ // allocate memory for client's ringbuffer
-                        DBG("allocate ringbuffer");
-                        c->buffer = sl_RB_new(s->buffer->length); // the same size as for master
-                    }
+                    closeclient(s, c);
+                    putslot(s, idx);
                 }
             }
         }
         // scan connections
         for(int fdidx = 1; fdidx < nfd; ++fdidx){
-            if((poll_set[fdidx].revents & POLLIN) == 0) continue;
             int fd = poll_set[fdidx].fd;
-            sl_sock_t *c = clients[fdidx];
-            pthread_mutex_lock(&c->mutex);
-            size_t nread = sl_RB_freesize(c->buffer);
-            if(nread > bufsize) nread = bufsize;
-            else if(nread < 1){ // no space in ringbuffer
+            sl_sock_t *c = clients[cidx[fdidx]];
+            if(poll_set[fdidx].revents & POLLOUT){ // send queued data
+                pthread_mutex_lock(&c->mutex);
+                int ok = flushout(c);
                 pthread_mutex_unlock(&c->mutex);
+                if(!ok){
+                    polldisconnect(s, poll_set, cidx, &nfd, fdidx--);
+                    continue;
+                }
+            }
+            if(lingering(c)){ // isn't read any more
+                if(poll_set[fdidx].revents & (POLLERR | POLLHUP)) polldisconnect(s, poll_set, cidx, &nfd, fdidx--);
+                continue;
+            }
+            if((poll_set[fdidx].revents & POLLIN) == 0) continue;
+            pthread_mutex_lock(&c->mutex);
+            ssize_t got = sl_RB_readfd(c->buffer, fd);
+            pthread_mutex_unlock(&c->mutex);
+            DBG("got %zd bytes", got);
+            if(got < 0 && errno == ENOBUFS){ // no space in ringbuffer
                 // check for RB overflow
                 if(sl_RB_hasbyte(c->buffer, '\n') < 0){ // -1 - buffer empty (can't be), -2 - buffer overflow
                     WARNX(_("Server thread: ring buffer overflow for fd=%d"), fd);
                     LOGERR(_("Server thread: ring buffer overflow for fd=%d"), fd);
-                    disconnect_(c, fdidx);
-                    --fdidx;
+                    polldisconnect(s, poll_set, cidx, &nfd, fdidx--);
                 }
                 continue;
             }
-            ssize_t got = read(fd, buf, nread);
-            DBG("can read %zd bytes, got %zd bytes, buf=_%s_", nread, got, buf);
-            pthread_mutex_unlock(&c->mutex);
-            if(got <= 0){ // client disconnected
-                disconnect_(c, fdidx);
-                --fdidx;
-            }else{
-                if(sl_RB_write(c->buffer, buf, got) < (size_t) got){
-                    WARNX(_("Server thread: can't write data to ringbuffer: overflow from fd=%d"), fd);
-                    disconnect_(c, fdidx);
-                    --fdidx;
-                }
-            }
+            if(got < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+            if(got == 0 && lingerclient(c, buf, bufsize)) continue; // client won't send more: answer and send the rest
+            if(got <= 0) // client disconnected
+                polldisconnect(s, poll_set, cidx, &nfd, fdidx--);
         }
         // and now check all incoming buffers
         for(int fdidx = 1; fdidx < nfd; ++fdidx){
-            sl_sock_t *c = clients[fdidx];
+            sl_sock_t *c = clients[cidx[fdidx]];
             if(!c->connected) continue;
-            ssize_t got = sl_RB_readline(c->buffer, (char*)buf, bufsize);
-            if(got < 0){ // buffer overflow
-                WARNX(_("Server thread: buffer overflow from fd=%d"), c->fd);
-                disconnect_(c, fdidx);
-                --fdidx;
+            int ok;
+            if(lingering(c)) // close when queue is sent or client doesn't take data
+                ok = lingerclient(c, buf, bufsize) && sl_dtime() < c->outq->closeat;
+            else ok = parseclient(c, buf, bufsize) || lingerclient(c, buf, bufsize);
+            if(!ok) polldisconnect(s, poll_set, cidx, &nfd, fdidx--);
+        }
+    }
+    // clear memory
+    FREE(buf);
+    FREE(poll_set);
+    FREE(cidx);
+    freeclients(s);
+errex:
+    s->connected = FALSE; // `rthread` stays valid: sl_sock_delete joins it
+    return NULL;
+}
+
+/**
+ * @brief readclient - read all available data from client's socket (edge-triggered mode)
+ *        and process full lines
+ * @param c - client
+ * @param buf - temporary buffer
+ * @param bufsize - its size
+ * @return FALSE if client should be disconnected
+ */
+static int readclient(sl_sock_t *c, uint8_t *buf, size_t bufsize){
+    while(c->connected){
+        ssize_t got = sl_RB_readfd(c->buffer, c->fd); // read directly into ring buffer
+        if(got < 0){
+            if(errno == EINTR) continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK) break; // all data read
+            if(errno != ENOBUFS) return FALSE;
+            // no space in ringbuffer: try to free it
+            if(!parseclient(c, buf, bufsize)) return FALSE;
+            if(c->http && outq_busy(c)) break; // requests wait for response sent, reading continues after it
+            if(sl_RB_freesize(c->buffer) < 1){
+                WARNX(_("Server thread: ring buffer overflow for fd=%d"), c->fd);
+                LOGERR(_("Server thread: ring buffer overflow for fd=%d"), c->fd);
+                return FALSE;
+            }
+            continue;
+        }
+        if(got == 0){ // client disconnected: process rest of data
+            parseclient(c, buf, bufsize);
+            return FALSE;
+        }
+    }
+    return parseclient(c, buf, bufsize);
+}
+
+// epoll_event.data.u32 of server's eventfd (0 is listening socket, other - clients' indexes)
+#define EVFD_IDX    (UINT32_MAX)
+// max amount of events got by one epoll_wait()
+#define EPOLL_MAXEVENTS     (64)
+
+#ifndef THREAD_NUMBER
+#define THREAD_NUMBER   (2)
+#endif
+
+/**
+ * @brief acceptclients - accept all new connections and add them to worker's epoll set
+ * @param w - worker
+ * @param epfd - worker's epoll descriptor
+ */
+static void acceptclients(sockworker_t *w, int epfd){
+    sl_sock_t *s = w->server;
+    while(1){
+        struct sockaddr a;
+        socklen_t len = sizeof(struct sockaddr);
+        int client = accept(w->listenfd, &a, &len);
+        if(client < 0){
+            if(errno == EINTR) continue;
+            if(errno != EAGAIN && errno != EWOULDBLOCK) WARN("accept()");
+            break;
+        }
+        int cidx = getslot(s);
+        DBG("New connection, slot %d", cidx);
+        if(cidx < 0){
+            WARNX(_("Limit of connections reached"));
+            if(s->toomuch_handler) s->toomuch_handler(client);
+            close(client);
+            continue;
+        }
+        sl_sock_t *c = s->clients[cidx];
+        int enable = 1;
+        if(ioctl(client, FIONBIO, (void *)&enable) < 0){ // edge-triggered mode needs nonblocking socket
+            WARN("Can't make socket non-blocked");
+            close(client);
+            putslot(s, cidx);
+            continue;
+        }
+        if(initclient(s, c, client, &a, len)){
+            // EPOLLOUT comes only when socket becomes writable after send() got EAGAIN
+            struct epoll_event ev = {.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data.u32 = (uint32_t)cidx};
+            if(0 == epoll_ctl(epfd, EPOLL_CTL_ADD, client, &ev)){
+                DBG("got client[%d], fd=%d", cidx, client);
                 continue;
-            }else if(got == 0){ // check last data in POST/GET methods
-                if(c->sockmethod == SOCKM_RAW) continue;
-                size_t l = sl_RB_datalen(c->buffer);
-                if(c->sockmethod == SOCKM_POST){
-                    if(l != (size_t)c->contlen) continue; // wait for last data
-                    if(l < bufsize - 1){
-                        sl_RB_read(c->buffer, buf, l);
-                        buf[l] = 0;
-                        parse_post_data(c, (char*)buf);
-                    }
-                }
-                disconnect_(c, fdidx);
-                --fdidx;
+            }
+            WARN("epoll_ctl()");
+        }
+        closeclient(s, c);
+        putslot(s, cidx);
+    }
+}
+
+// remove client from worker's list of lingering clients
+static void unlinger(sockworker_t *w, int idx){
+    for(size_t i = 0; i < w->linger.len; ++i)
+        if(w->linger.data[i] == idx){
+            w->linger.data[i] = w->linger.data[--w->linger.len];
+            return;
+        }
+}
+
+// close worker's lingering clients which didn't take data for OUTQ_LINGER seconds
+static void closelingering(sockworker_t *w){
+    sl_sock_t *s = w->server;
+    double now = sl_dtime();
+    for(size_t i = 0; i < w->linger.len;){
+        int idx = w->linger.data[i];
+        sl_sock_t *c = s->clients[idx];
+        if(now < c->outq->closeat){ ++i; continue; }
+        DBG("Lingering client fd=%d timed out", c->fd);
+        closeclient(s, c);
+        putslot(s, idx);
+        w->linger.data[i] = w->linger.data[--w->linger.len];
+    }
+}
+
+/**
+ * @brief epollworker - edge-triggered epoll() event loop
+ *        worker sleeps while idle and processes only sockets which really got data
+ * @param d - worker's data
+ * @return NULL
+ */
+static void *epollworker(void *d){
+    sockworker_t *w = (sockworker_t*) d;
+    sl_sock_t *s = w->server;
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if(epfd < 0){
+        WARN("epoll_create1()");
+        return NULL;
+    }
+    struct epoll_event ev = {.events = EPOLLIN, .data.u32 = 0};
+#ifdef EPOLLEXCLUSIVE
+    // don't wake up all workers on each new connection to shared listening socket
+    if(w->listenfd == s->fd && s->srvdata->nworkers > 1) ev.events |= EPOLLEXCLUSIVE;
+#endif
+    if(epoll_ctl(epfd, EPOLL_CTL_ADD, w->listenfd, &ev)){
+        WARN("epoll_ctl()");
+        close(epfd);
+        return NULL;
+    }
+    ev.events = EPOLLIN;
+    ev.data.u32 = EVFD_IDX;
+    if(epoll_ctl(epfd, EPOLL_CTL_ADD, s->evfd, &ev)){
+        WARN("epoll_ctl()");
+        close(epfd);
+        return NULL;
+    }
+    DBG("Start epoll worker, listenfd=%d", w->listenfd);
+    size_t bufsize = s->buffer->length;
+    uint8_t *buf = MALLOC(uint8_t, bufsize);
+    struct epoll_event events[EPOLL_MAXEVENTS];
+    while(s->connected){
+        // sleep while idle, but check lingering clients' timeouts once a second
+        int n = epoll_wait(epfd, events, EPOLL_MAXEVENTS, w->linger.len ? 1000 : -1);
+        if(n < 0){
+            if(errno == EINTR) continue;
+            WARN("epoll_wait()");
+            break;
+        }
+        for(int i = 0; i < n; ++i){
+            uint32_t idx = events[i].data.u32;
+            // don't read eventfd: it should stay ready to stop all workers
+            if(idx == EVFD_IDX) continue;
+            if(idx == 0){
+                acceptclients(w, epfd);
                 continue;
             }
-            if(got > 1 && *buf && *buf != '\r'){ // not empty line
-                if(buf[got-2] == '\r'){
-                    buf[got-2] = 0; // omit '\r' for "\r\n"
-                    DBG("delete \\r: _%s_", buf);
-                }
-                sl_sock_hresult_e r = msgparser(c, (char*)buf);
-                if(r != RESULT_SILENCE) sl_sock_sendstrmessage(c, sl_sock_hresult2str(r));
+            if(idx > (uint32_t)clientslots(s)) continue; // `maxclients` could be lowered after start
+            sl_sock_t *c = s->clients[idx];
+            if(!c->connected) continue;
+            int ok = TRUE, rd = events[i].events & EPOLLIN;
+            if((events[i].events & EPOLLOUT) && c->outq){ // send queued data
+                pthread_mutex_lock(&c->mutex);
+                ok = flushout(c);
+                pthread_mutex_unlock(&c->mutex);
+                if(c->http && !outq_busy(c)) rd = TRUE; // response sent: continue with the next requests
+            }
+            int broken = events[i].events & (EPOLLHUP | EPOLLERR);
+            if(lingering(c)){ // isn't read any more: close when queue is sent
+                if(ok && !broken && lingerclient(c, buf, bufsize)) continue;
+                unlinger(w, (int)idx);
             }else{
-                DBG("EMPTY line");
-                if(c->sockmethod != SOCKM_RAW) c->gotemptyline = TRUE;
+                if(ok && rd) ok = readclient(c, buf, bufsize);
+                if(ok && (events[i].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP))){
+                    if(events[i].events & EPOLLRDHUP) readclient(c, buf, bufsize);
+                    ok = FALSE;
+                }
+                if(ok) continue;
+                if(!broken && lingerclient(c, buf, bufsize)){
+                    intvec_push(&w->linger, (int)idx);
+                    continue;
+                }
             }
-            ++c->lineno;
+            // closed fd will be removed from epoll set automatically
+            closeclient(s, c);
+            putslot(s, (int)idx);
         }
+        if(w->linger.len) closelingering(w);
     }
-    // clear memory
+    intvec_free(&w->linger);
     FREE(buf);
-    FREE(poll_set);
-    for(int i = s->maxclients; i > 0; --i){
-        DBG("Clear %dth client data", i);
-        sl_sock_t *c = clients[i];
-        if(c->fd > -1) close(c->fd);
-        if(c->buffer) sl_RB_delete(&c->buffer);
-        FREE(c->addrinfo->ai_addr);
-        FREE(c->addrinfo);
-        FREE(c->node);
-        FREE(c->service);
-        FREE(c);
-    }
-    FREE(clients);
-    s->clients = NULL;
+    close(epfd);
+    return NULL;
+}
+
+/**
+ * @brief serverthread_epoll - the same as `serverthread`, but with epoll() workers
+ *        runs all workers except the first, which works in this thread
+ * @param d - socket descriptor
+ * @return NULL
+ */
+static void *serverthread_epoll(void *d){
+    sl_sock_t *s = (sl_sock_t*) d;
+    if(!s || !s->srvdata || (!s->handlers && !s->defmsg_handler)){
+        WARNX(_("Can't start server handlers thread"));
+        goto errex;
+    }
+    sl_sock_srvdata_t *sd = s->srvdata;
+    for(int i = 1; i < sd->nworkers; ++i){
+        sockworker_t *w = &sd->workers[i];
+        if(pthread_create(&w->thread, NULL, epollworker, (void*)w)){
+            WARN("pthread_create()");
+            w->thread = 0;
+            if(w->listenfd != s->fd){ // nobody will accept connections from it
+                close(w->listenfd);
+                w->listenfd = -1;
+            }
+        }
+    }
+    epollworker(&sd->workers[0]);
+    // stop all workers if the first one died
+    s->connected = FALSE;
+    wakeserver(s);
+    for(int i = 1; i < sd->nworkers; ++i)
+        if(sd->workers[i].thread) pthread_join(sd->workers[i].thread, NULL);
+    freeclients(s);
 errex:
-    s->rthread = 0;
+    s->connected = FALSE;
     return NULL;
 }
 
+static int sockopen(sl_socktype_e type, const char *path, int isserver, int ai_socktype, int reuseport);
+
+/**
+ * @brief initsrvdata - prepare server's data (clients' slots and `nworkers` event loops for epoll)
+ * @param s - server
+ * @param type - socket type
+ * @param path - socket path
+ * @param nworkers - amount of worker threads
+ * @return FALSE if failed
+ */
+static int initsrvdata(sl_sock_t *s, sl_socktype_e type, const char *path, int nworkers){
+    sl_sock_srvdata_t *d = MALLOC(sl_sock_srvdata_t, 1);
+    pthread_mutex_init(&d->mutex, NULL);
+    // pointers to all clients are allocated at once to be read without locking, records - on demand
+    d->pool = sl_pool_new(sizeof(clrec_t), CLIENTS_PERSLAB);
+    s->clients = MALLOC(sl_sock_t*, s->maxclients + 1);
+    d->maxslots = s->maxclients;
+    s->srvdata = d;
+    if(s->evmode != SOCKEV_EPOLL) return TRUE;
+    if(nworkers < 1) nworkers = 1;
+    s->evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(s->evfd < 0){
+        WARN("eventfd()");
+        return FALSE;
+    }
+    d->workers = MALLOC(sockworker_t, nworkers);
+    d->nworkers = nworkers;
+    for(int i = 0; i < nworkers; ++i){
+        sockworker_t *w = &d->workers[i];
+        w->server = s;
+        w->listenfd = s->fd;
+        // UNIX sockets can't reuse port, so all workers share the same listening socket
+        if(i == 0 || type == SOCKT_UNIX) continue;
+        int fd = sockopen(type, path, 1, 0, 1);
+        if(fd < 0 || listen(fd, s->maxclients) == -1){
+            WARN(_("Can't open listening socket for worker #%d"), i);
+            if(fd > -1) close(fd);
+            d->nworkers = i;
+            break;
+        }
+        w->listenfd = fd;
+    }
+    DBG("%d workers", d->nworkers);
+    return TRUE;
+}
+
+// close workers' sockets and free server's data
+static void freesrvdata(sl_sock_t *s){
+    sl_sock_srvdata_t *d = s->srvdata;
+    if(!d) return;
+    for(int i = 0; i < d->nworkers; ++i){
+        int fd = d->workers[i].listenfd;
+        if(fd > -1 && fd != s->fd) close(fd);
+    }
+    FREE(d->workers);
+    for(int i = d->nslots; i > 0; --i) pthread_mutex_destroy(&s->clients[i]->mutex);
+    FREE(s->clients);
+    intvec_free(&d->freeidx);
+    sl_pool_delete(&d->pool);
+    pthread_mutex_destroy(&d->mutex);
+    FREE(s->srvdata);
+}
+
 // convert UNIX socket name for unaddr; result should be free'd
 static char *convunsname(const char *path, socklen_t *nbytes){
     char *apath = MALLOC(char, UNIX_SOCK_PATH_MAX);
@@ -667,6 +1526,11 @@ static void mknodeservice(const char *path, char **node, char **service){
  * @return file descriptor or -1 if can't open
  */
 int sl_sock_open(sl_socktype_e type, const char *path, int isserver, int ai_socktype){
+    return sockopen(type, path, isserver, ai_socktype, 0);
+}
+
+// the same as `sl_sock_open`, but also sets SO_REUSEPORT for server if `reuseport` is TRUE
+static int sockopen(sl_socktype_e type, const char *path, int isserver, int ai_socktype, int reuseport){
     FNAME();
     if(!path || type >= SOCKT_AMOUNT) return -1;
     if(ai_socktype < 1) ai_socktype = SOCK_STREAM;
@@ -727,6 +1591,11 @@ int sl_sock_open(sl_socktype_e type, const char *path, int isserver, int ai_sock
                 close(sock); sock = -1;
                 continue;
             }
+            if(reuseport && setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &reuseaddr, sizeof(int)) == -1){
+                WARN("setsockopt()");
+                close(sock); sock = -1;
+                continue;
+            }
             if(bind(sock, p->ai_addr, p->ai_addrlen) == -1){
                 WARN("bind()");
                 close(sock); sock = -1;
@@ -755,21 +1624,46 @@ int sl_sock_open(sl_socktype_e type, const char *path, int isserver, int ai_sock
  * @param path - path (for UNIX socket); for NET: ":port" for server, "server:port" for client
  * @param handlers - standard handlers when read data (or NULL)
  * @param bufsiz - input ring buffer size
- * @param isserver - 1 for server, 0 for client
+ * @param srvopts - NULL for client or server's parameters
  * @return socket descriptor or NULL if failed
  * to create anonymous UNIX-socket you can start "path" from 0 or from string "\0"
  */
-static sl_sock_t *sl_sock_run(sl_socktype_e type, const char *path, sl_sock_hitem_t *handlers, int bufsiz, int isserver){
+static sl_sock_t *sl_sock_run(sl_socktype_e type, const char *path, sl_sock_hitem_t *handlers, int bufsiz, const sl_sock_srvopts_t *srvopts){
     FNAME();
+    int isserver = (srvopts) ? 1 : 0;
+    if(isserver && srvopts->evmode >= SOCKEV_AMOUNT){
+        WARNX(_("Wrong server event loop type %d"), srvopts->evmode);
+        return NULL;
+    }
+    if(isserver && srvopts->oqpolicy >= SOCKOQ_AMOUNT){
+        WARNX(_("Wrong output queue policy %d"), srvopts->oqpolicy);
+        return NULL;
+    }
     if(bufsiz < 256) bufsiz = 256;
-    int sock = sl_sock_open(type, path, isserver, 0);
+    int nworkers = 0;
+    if(isserver){
+        nworkers = srvopts->nworkers;
+        if(nworkers < 0) nworkers = THREAD_NUMBER;
+    }
+    // all sockets of workers' pool should have SO_REUSEPORT
+    int sock = sockopen(type, path, isserver, 0, nworkers > 1 && type != SOCKT_UNIX);
     if(sock < 0) return NULL;
     sl_sock_t *s = MALLOC(sl_sock_t, 1);
     s->type = type;
     s->fd = -1;
+    s->evfd = -1;
+    s->linefd = -1;
+    pthread_mutex_init(&s->rmutex, NULL);
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&s->rcond, &ca);
+    pthread_condattr_destroy(&ca);
     s->maxclients = SL_DEF_MAXCLIENTS;
     s->handlers = handlers;
-    s->buffer = sl_RB_new(bufsiz);
+    s->hindex = hindex_new(handlers);
+    // client's buffer is filled by `clientrbthread` and read by user or handlers in the same thread
+    s->buffer = isserver ? sl_RB_new(bufsiz) : sl_RB_new_spsc(bufsiz);
     if(!s->buffer){
         sl_sock_delete(&s);
         return NULL;
@@ -801,18 +1695,29 @@ static sl_sock_t *sl_sock_run(sl_socktype_e type, const char *path, sl_sock_hite
     pthread_mutex_init(&s->mutex, NULL);
     DBG("s->fd=%d, node=%s, service=%s", s->fd, s->node, s->service);
     int r = -1;
+    s->connected = TRUE; // set it before thread started: thread works while it is TRUE
     if(isserver){
-        if(s->handlers || s->defmsg_handler)
-            r = pthread_create(&s->rthread, NULL, serverthread, (void*)s);
-        else r = 0;
+        if(srvopts->maxclients > 0) s->maxclients = srvopts->maxclients;
+        s->evmode = srvopts->evmode;
+        s->outqsize = srvopts->outqsize ? srvopts->outqsize : SL_DEF_OUTQSIZE;
+        s->oqpolicy = srvopts->oqpolicy;
+        if(nworkers > 1) s->evmode = SOCKEV_EPOLL; // pool of workers works only with epoll()
+        if(s->handlers || s->defmsg_handler){
+            // listen here to be ready for connections just after return
+            if(listen(s->fd, s->maxclients) == -1) WARN("listen");
+            else if(initsrvdata(s, type, path, nworkers))
+                r = pthread_create(&s->rthread, NULL, (s->evmode == SOCKEV_EPOLL) ? serverthread_epoll : serverthread, (void*)s);
+        }else r = 0;
     }else{
-        r = pthread_create(&s->rthread, NULL, clientrbthread, (void*)s);
+        s->evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(s->evfd < 0) WARN("eventfd()");
+        else r = pthread_create(&s->rthread, NULL, clientrbthread, (void*)s);
     }
     if(r){
         WARN("pthread_create()");
+        s->connected = FALSE;
         sl_sock_delete(&s);
     }else{
-        s->connected = TRUE;
         DBG("fd=%d CONNECTED", s->fd);
     }
     return s;
@@ -827,12 +1732,12 @@ static sl_sock_t *sl_sock_run(sl_socktype_e type, const char *path, sl_sock_hite
  * @return socket descriptor or NULL if failed
  */
 sl_sock_t *sl_sock_run_client(sl_socktype_e type, const char *path, int bufsiz){
-    sl_sock_t *s = sl_sock_run(type, path, NULL, bufsiz, 0);
+    sl_sock_t *s = sl_sock_run(type, path, NULL, bufsiz, NULL);
     return s;
 }
 
 /**
- * @brief sl_sock_run_server - run built-in server parser
+ * @brief sl_sock_run_server - run built-in server parser (default parameters, but clients' data is sent by blocking `send()`)
  * @param type - server type
  * @param path - path or port
  * @param handlers - array with handlers
@@ -840,8 +1745,23 @@ sl_sock_t *sl_sock_run_client(sl_socktype_e type, const char *path, int bufsiz){
  * @return socket descriptor or NULL if failed
  */
 sl_sock_t *sl_sock_run_server(sl_socktype_e type, const char *path, int bufsiz, sl_sock_hitem_t *handlers){
-    sl_sock_t *s = sl_sock_run(type, path, handlers, bufsiz, 1);
-    return s;
+    sl_sock_srvopts_t opts = {.outqsize = -1}; // blocking send as in old versions; queues are enabled by `sl_sock_run_server_ext`
+    return sl_sock_run(type, path, handlers, bufsiz, &opts);
+}
+
+/**
+ * @brief sl_sock_run_server_ext - run built-in server parser with non-default parameters
+ * @param type - server type
+ * @param path - path or port
+ * @param bufsiz - input ring buffer size
+ * @param handlers - array with handlers
+ * @param opts - server parameters (max clients amount, event loop type etc) or NULL for defaults
+ * @return socket descriptor or NULL if failed
+ */
+sl_sock_t *sl_sock_run_server_ext(sl_socktype_e type, const char *path, int bufsiz, sl_sock_hitem_t *handlers, const sl_sock_srvopts_t *opts){
+    sl_sock_srvopts_t defopts = {0};
+    if(!opts) opts = &defopts;
+    return sl_sock_run(type, path, handlers, bufsiz, opts);
 }
 
 /**
@@ -854,29 +1774,23 @@ sl_sock_t *sl_sock_run_server(sl_socktype_e type, const char *path, int bufsiz,
 ssize_t sl_sock_sendbinmessage(sl_sock_t *socket, const uint8_t *msg, size_t l){
     if(!msg || l < 1) return -1;
     if(socket->sockmethod != SOCKM_RAW){ // just fill buffer while socket isn't marked as "RAW"
-        DBG("Put to buffer: _%s_", (char*)msg);
-        size_t L = BUFSIZ - socket->outplen;
-        if(l > L) l = L;
-        memcpy(socket->outbuffer + socket->outplen, msg, l);
-        socket->outplen += l;
-        DBG("Now buflen=%zd, buf: ```%s```", socket->outplen, socket->outbuffer);
-        return l;
+        pthread_mutex_lock(&socket->mutex);
+        int inbuf = (socket->sockmethod != SOCKM_RAW); // response could be sent just now
+        if(inbuf) outbuf_add(socket, msg, l);
+        pthread_mutex_unlock(&socket->mutex);
+        if(inbuf){
+            DBG("Put to buffer %zd bytes, now buflen=%zd", l, socket->outplen);
+            return l;
+        }
     }
     DBG("send to fd=%d message with len=%zd (%s)", socket->fd, l, msg);
+    if(socket->outq) return queuemessage(socket, msg, l, NULL);
     while(socket && socket->connected && 1 != sl_canwrite(socket->fd));
     if(!socket || !socket->connected) return -1;
     DBG("lock");
     pthread_mutex_lock(&socket->mutex);
     DBG("SEND");
-    ssize_t sent = 0;
-    do{
-        ssize_t r = send(socket->fd, msg+sent, l, MSG_NOSIGNAL);
-        if(r < 0){
-            sent = -1;
-            break;
-        }else sent += r;
-        DBG("sent %zd bytes", r);
-    } while((size_t)sent != l);
+    ssize_t sent = sendblocking(socket, msg, l);
     DBG("unlock");
     pthread_mutex_unlock(&socket->mutex);
     return sent;
@@ -895,15 +1809,17 @@ ssize_t sl_sock_sendstrmessage(sl_sock_t *socket, const char *msg){
  * @return -1 in case of error, 1 if all OK
  */
 ssize_t sl_sock_sendbyte(sl_sock_t *socket, uint8_t byte){
-    while(socket && socket->connected && !sl_canwrite(socket->fd));
     if(!socket || !socket->connected) return -1;
     if(socket->sockmethod != SOCKM_RAW){ // just fill buffer while socket isn't marked as "RAW"
-        DBG("Put to buffer: _%c_", (char)byte);
-        if(socket->outplen == BUFSIZ) return 0;
-        socket->outbuffer[socket->outplen++] = (char)byte;
-        DBG("Now buflen=%zd, buf: ```%s```", socket->outplen, socket->outbuffer);
-        return 1;
+        pthread_mutex_lock(&socket->mutex);
+        int inbuf = (socket->sockmethod != SOCKM_RAW);
+        if(inbuf) outbuf_add(socket, &byte, 1);
+        pthread_mutex_unlock(&socket->mutex);
+        if(inbuf) return 1;
     }
+    if(socket->outq) return queuemessage(socket, &byte, 1, NULL);
+    while(socket && socket->connected && !sl_canwrite(socket->fd));
+    if(!socket || !socket->connected) return -1;
     DBG("lock");
     pthread_mutex_lock(&socket->mutex);
     ssize_t r = send(socket->fd, &byte, 1, MSG_NOSIGNAL);
@@ -921,7 +1837,82 @@ ssize_t sl_sock_sendbyte(sl_sock_t *socket, uint8_t byte){
  */
 ssize_t sl_sock_readline(sl_sock_t *sock, char *str, size_t len){
     if(!sock || !sock->buffer || !str || !len) return -1;
-    return sl_RB_readline(sock->buffer, str, len);
+    ssize_t got = sl_RB_readline(sock->buffer, str, len);
+    if(got > 0){ // wake client's reader if it waits for free space
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if(__atomic_load_n(&sock->rbfull, __ATOMIC_SEQ_CST)) wakereaders(sock);
+    }
+    if(sock->linefd > -1 && sl_RB_hasbyte(sock->buffer, '\n') < 0) clearline(sock);
+    return got;
+}
+
+/**
+ * @brief sl_sock_readline_wait - read string line from client's incoming ringbuffer waiting for it no more than `timeout`
+ * @param sock - client socket
+ * @param str (o) - buffer to copy
+ * @param len - length of str
+ * @param timeout - max waiting time, seconds (<0 - wait forever)
+ * @return amount of bytes read, 0 on timeout or -1 if disconnected (or line is too long for `str`)
+ */
+ssize_t sl_sock_readline_wait(sl_sock_t *sock, char *str, size_t len, double timeout){
+    ssize_t got = sl_sock_readline(sock, str, len);
+    if(got) return got;
+    if(!sl_sock_waitline(sock, timeout)){ // timeout or disconnection, but line could come just now
+        got = sl_sock_readline(sock, str, len);
+        if(got) return got;
+        return sock->connected ? 0 : -1;
+    }
+    return sl_sock_readline(sock, str, len);
+}
+
+/**
+ * @brief sl_sock_linefd - get descriptor for poll()/epoll() which is readable while client's input buffer
+ *        has full line (or when client disconnected); read lines by `sl_sock_readline` until it returns 0
+ *        (don't read descriptor itself); call this from thread that reads lines
+ * @param sock - client socket
+ * @return descriptor (closed by `sl_sock_delete`) or -1 if failed
+ */
+int sl_sock_linefd(sl_sock_t *sock){
+    if(!sock || !sock->buffer || !sock->rthread) return -1;
+    if(sock->linefd > -1) return sock->linefd;
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(fd < 0){
+        WARN("eventfd()");
+        return -1;
+    }
+    __atomic_store_n(&sock->linefd, fd, __ATOMIC_SEQ_CST);
+    // lines got before reader thread saw `linefd`
+    if(sl_RB_hasbyte(sock->buffer, '\n') > -1 || !sock->connected) notifyline(sock);
+    return fd;
+}
+
+/**
+ * @brief sl_sock_waitline - wait until client's input buffer has full line (to read it by `sl_sock_readline`)
+ * @param sock - client socket (made by `sl_sock_run_client`)
+ * @param timeout - max waiting time, seconds (<0 - wait forever)
+ * @return TRUE if there's a line, FALSE on timeout or if socket disconnected
+ */
+int sl_sock_waitline(sl_sock_t *sock, double timeout){
+    if(!sock || !sock->buffer || !sock->rthread) return FALSE;
+    struct timespec ts;
+    if(timeout >= 0.){
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        double t = ts.tv_sec + ts.tv_nsec / 1e9 + timeout;
+        ts.tv_sec = (time_t)t;
+        ts.tv_nsec = (long)((t - ts.tv_sec) * 1e9);
+    }
+    int ret = FALSE;
+    pthread_mutex_lock(&sock->rmutex);
+    // reader thread signals under `rmutex` after new data written, so checks here can't miss it
+    while(!(ret = (sl_RB_hasbyte(sock->buffer, '\n') > -1)) && sock->connected){
+        if(timeout < 0.) pthread_cond_wait(&sock->rcond, &sock->rmutex);
+        else if(ETIMEDOUT == pthread_cond_timedwait(&sock->rcond, &sock->rmutex, &ts)){
+            ret = (sl_RB_hasbyte(sock->buffer, '\n') > -1);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sock->rmutex);
+    return ret;
 }
 
 // default handlers - setters/getters of int64, double and string
@@ -19,13 +19,18 @@
  * MA 02110-1301, USA.
  */
 
+#define _GNU_SOURCE       // ppoll
 #include <ctype.h> // isspace
 #include <err.h>
 #include <fcntl.h>
 #include <linux/limits.h> // PATH_MAX
 #include <locale.h>
 #include <math.h>         // floor
+#include <poll.h>
+#include <signal.h>       // pthread_sigmask
+#include <spawn.h>        // posix_spawnp
 #include <stdarg.h>
+#include <stddef.h>       // ptrdiff_t
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -35,6 +40,7 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/wait.h>     // waitpid
 #include <time.h>
 #include <unistd.h>
 
@@ -234,6 +240,49 @@ void *sl_alloc(size_t N, size_t S){
     return p;
 }
 
+/**
+ * @brief sl_vec_grow - reallocate growable array (see SL_VEC) to hold at least `n` items
+ * @param data - array data (or NULL)
+ * @param cap (io) - its capacity
+ * @param n - amount of items needed
+ * @param S - size of single item
+ * @return new array data or die
+ */
+void *sl_vec_grow(void *data, size_t *cap, size_t n, size_t S){
+    if(n <= *cap) return data;
+    size_t newcap = (*cap < SL_VEC_MINCAP) ? SL_VEC_MINCAP : *cap;
+    while(newcap < n){
+        if(newcap > SIZE_MAX / 2) newcap = n;
+        else newcap *= 2;
+    }
+    if(S && newcap > SIZE_MAX / S) ERRX(_("Too large memory block: %zd x %zd bytes"), newcap, S);
+    data = realloc(data, newcap * S);
+    if(!data) ERR("realloc()");
+    *cap = newcap;
+    return data;
+}
+
+/**
+ * @brief sl_vec_shrink - free unused capacity of growable array (see SL_VEC)
+ * @param data - array data
+ * @param cap (io) - its capacity
+ * @param len - amount of items in array
+ * @param S - size of single item
+ * @return new array data (NULL for empty array) or die
+ */
+void *sl_vec_shrink(void *data, size_t *cap, size_t len, size_t S){
+    if(!len){
+        FREE(data);
+        *cap = 0;
+        return NULL;
+    }
+    if(len >= *cap) return data;
+    data = realloc(data, len * S);
+    if(!data) ERR("realloc()");
+    *cap = len;
+    return data;
+}
+
 /**
  * @brief sl_mmap - mmap file to a memory area
  * @param filename (i) - name of file to mmap
@@ -258,7 +307,8 @@ sl_mmapbuf_t *sl_mmap(char *filename){
         return NULL;
     }
     Mlen = statbuf.st_size;
-    if((ptr = mmap (0, Mlen, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED){
+    if(!Mlen) ptr = NULL; // empty file can't be mapped
+    else if((ptr = mmap (0, Mlen, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED){
         WARN(_("Mmap error for input"));
         close(fd);
         return NULL;
@@ -275,12 +325,80 @@ sl_mmapbuf_t *sl_mmap(char *filename){
  * @param b (i) - mmap'ed buffer
  */
 void sl_munmap(sl_mmapbuf_t *b){
-    if(munmap(b->data, b->len)){
+    if(!b) return;
+    if(b->data && munmap(b->data, b->len)){
         ERR(_("Can't munmap"));
     }
     FREE(b);
 }
 
+// size of area prefetched by line iterator at once
+#define MMAP_WINDOW     (4UL << 20)
+
+// ask kernel to read next window of file while we parse current one
+static void mmap_prefetch(sl_mmapiter_t *it){
+    while(it->ahead < it->buf->len && it->pos + MMAP_WINDOW > it->ahead){
+        size_t l = it->buf->len - it->ahead;
+        if(l > MMAP_WINDOW) l = MMAP_WINDOW;
+        madvise(it->buf->data + it->ahead, l, MADV_WILLNEED);
+        it->ahead += MMAP_WINDOW;
+    }
+}
+
+/**
+ * @brief sl_mmap_iter - mmap file for sequential reading by lines (or other records)
+ * @param filename - name of file
+ * @param delim - records' delimiter ('\n' for lines)
+ * @return iterator or NULL if file can't be mapped
+ */
+sl_mmapiter_t *sl_mmap_iter(char *filename, int delim){
+    sl_mmapbuf_t *b = sl_mmap(filename);
+    if(!b) return NULL;
+    sl_mmapiter_t *it = MALLOC(sl_mmapiter_t, 1);
+    it->buf = b;
+    it->delim = delim;
+    if(b->len){ // hints could fail (e.g. no THP for files), this isn't an error
+        madvise(b->data, b->len, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+        madvise(b->data, b->len, MADV_HUGEPAGE);
+#endif
+        mmap_prefetch(it);
+    }
+    return it;
+}
+
+/**
+ * @brief sl_mmap_next - get next record of file (without copying)
+ * @param it - iterator
+ * @param rec (o) - start of record in mapped file (not zero-terminated!)
+ * @param len (o) - record's length without delimiter
+ * @return FALSE when file is over; the last record could have no delimiter;
+ *         records stay valid until `sl_mmap_iterfree`
+ */
+int sl_mmap_next(sl_mmapiter_t *it, const char **rec, size_t *len){
+    if(!it || !it->buf || it->pos >= it->buf->len) return FALSE;
+    const char *start = it->buf->data + it->pos;
+    size_t rest = it->buf->len - it->pos;
+    const char *end = memchr(start, it->delim, rest);
+    size_t l = end ? (size_t)(end - start) : rest;
+    it->pos += end ? l + 1 : l;
+    ++it->lineno;
+    if(it->pos + MMAP_WINDOW > it->ahead) mmap_prefetch(it);
+    if(rec) *rec = start;
+    if(len) *len = l;
+    return TRUE;
+}
+
+/**
+ * @brief sl_mmap_iterfree - unmap file and free iterator
+ * @param it - iterator
+ */
+void sl_mmap_iterfree(sl_mmapiter_t **it){
+    if(!it || !*it) return;
+    sl_munmap((*it)->buf);
+    FREE(*it);
+}
+
 /**
  * @brief sl_omitspaces - omit leading spaces
  * @param v - source string
@@ -418,67 +536,832 @@ int sl_str2i(int *num, const char *str){
 
 
 /**
- * @brief sl_canread - run select() for given fd
+ * @brief waitfd - run ppoll() with 100us timeout for given fd
+ *        (select() can't work with descriptors greater than FD_SETSIZE)
  * @param fd - file descriptor
- * @return -1 if EINTR, 0 if none, 1 if ready to read
+ * @param events - POLLIN or POLLOUT
+ * @return -1 if error, 0 if none, 1 if ready
  */
-int sl_canread(int fd){
+static int waitfd(int fd, short events){
     if(fd < 0) return -1;
-    fd_set fds;
-    struct timeval timeout;
-    timeout.tv_sec = 0;
-    timeout.tv_usec = 100;
-    FD_ZERO(&fds);
-    FD_SET(fd, &fds);
+    struct pollfd pfd = {.fd = fd, .events = events};
+    struct timespec timeout = {.tv_sec = 0, .tv_nsec = 100000};
     do{
-        int rc = select(fd+1, &fds, NULL, NULL, &timeout);
+        int rc = ppoll(&pfd, 1, &timeout, NULL);
         if(rc < 0){
             if(errno != EINTR){
-                WARN("select()");
+                WARN("ppoll()");
                 return -1;
             }
             continue;
         }
         break;
     }while(1);
-    if(FD_ISSET(fd, &fds)) return 1;
+    // error or hangup means that next read/write won't block too
+    if(pfd.revents & (events | POLLERR | POLLHUP)) return 1;
     return 0;
 }
 
 /**
- * @brief sl_canwrite - run select() for given fd
+ * @brief sl_canread - check if fd is ready for reading (wait not more than 100us)
  * @param fd - file descriptor
- * @return -1 if EINTR, 0 if none, 1 if ready to write without blocking
+ * @return -1 if error, 0 if none, 1 if ready to read
+ */
+int sl_canread(int fd){
+    return waitfd(fd, POLLIN);
+}
+
+/**
+ * @brief sl_canwrite - check if fd is ready for writing (wait not more than 100us)
+ * @param fd - file descriptor
+ * @return -1 if error, 0 if none, 1 if ready to write without blocking
  */
 int sl_canwrite(int fd){
-    fd_set fds;
-    struct timeval timeout;
-    timeout.tv_sec = 0;
-    timeout.tv_usec = 100;
-    FD_ZERO(&fds);
-    FD_SET(fd, &fds);
     //DBG("try ability of written to %d", fd);
-    do{
-        int rc = select(fd+1, NULL, &fds, NULL, &timeout);
-        if(rc < 0){
-            DBG("-1");
-            if(errno != EINTR){
-                LOGWARN("select()");
-                WARN("select()");
-                return -1;
-            }
-            continue;
-        }
-        break;
-    }while(1);
-    if(FD_ISSET(fd, &fds)) return 1;
-    return 0;
+    return waitfd(fd, POLLOUT);
 }
 
 /******************************************************************************\
  *                              Logging to file
 \******************************************************************************/
 sl_log_t *sl_globlog = NULL; // "global" log file (the first opened logfile)
+
+// minimal size of threads' queues and format buffers of asynchronous log
+#define LOG_MINQSIZE    (1024)
+#define LOG_MINBUF      (256)
+// max length of timestamp
+#define LOG_TIMELEN     (32)
+// max amount of parts in one writev()
+#define LOG_IOVMAX      (64)
+
+// queue of one thread writing to asynchronous log
+typedef struct{
+    sl_ringbuffer_t *rb;    // formatted records (SPSC: thread -> writer)
+    char *buf;              // buffer to format record
+    size_t bufsz;           // its size
+    int dead;               // thread exited, free queue after draining
+} logthrbuf_t;
+
+// asynchronous writer of log
+typedef struct sl_logasync{
+    size_t qsize;           // size of threads' queues
+    double flushint;        // max interval between flushes
+    pthread_key_t key;      // thread's logthrbuf_t
+    pthread_mutex_t regmutex;   // protects `bufs`
+    logthrbuf_t **bufs;     // queues of all threads
+    int nbufs;              // amount of queues
+    int bufsalloc;          // allocated size of `bufs`
+    pthread_mutex_t drainmutex; // only one thread drains queues
+    pthread_mutex_t cmutex; // protects `stop`
+    pthread_cond_t cond;    // wake writer
+    int stop;               // writer should quit
+    pthread_t writer;       // writer thread
+    size_t dropped;         // records dropped because of full queue
+    size_t dreported;       // dropped records already reported in log
+} sl_logasync_t;
+
+// asynchronous logs to flush at exit
+static pthread_mutex_t asynclogs_mutex = PTHREAD_MUTEX_INITIALIZER;
+static sl_log_t **asynclogs = NULL;
+static int nasynclogs = 0, asynclogsalloc = 0;
+
+static const char *lvlprefix(sl_loglevel_e lvl){
+    switch(lvl){
+        case LOGLEVEL_ERR:
+            return "[ERR]";
+        case LOGLEVEL_WARN:
+            return "[WARN]";
+        case LOGLEVEL_MSG:
+            return "[MSG]";
+        case LOGLEVEL_DBG:
+            return "[DBG]";
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * @brief logtime - put timestamp "YYYY/mm/dd-HH:MM:SS[.uuuuuu]" into buffer
+ *        calendar conversion is made only when second changes (cache of each thread)
+ * @param buf - buffer (not less than LOG_TIMELEN)
+ * @param usec - !=0 to add microseconds
+ * @return length of timestamp
+ */
+static size_t logtime(char *buf, int usec){
+    static __thread time_t lastsec = -1;
+    static __thread char laststr[LOG_TIMELEN];
+    static __thread size_t lastlen = 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    if(ts.tv_sec != lastsec){
+        struct tm curtm;
+        localtime_r(&ts.tv_sec, &curtm);
+        lastlen = strftime(laststr, LOG_TIMELEN, "%Y/%m/%d-%H:%M:%S", &curtm);
+        lastsec = ts.tv_sec;
+    }
+    memcpy(buf, laststr, lastlen);
+    size_t l = lastlen;
+    if(usec){
+        long u = ts.tv_nsec / 1000;
+        buf[l] = '.';
+        for(int i = 6; i > 0; --i, u /= 10) buf[l + i] = '0' + u % 10;
+        l += 7;
+    }
+    return l;
+}
+
+/**
+ * @brief recheader - put header of record ("[ERR]\tYYYY/mm/dd-HH:MM:SS\t") into buffer
+ * @param buf - buffer (not less than LOG_MINBUF)
+ * @return length of header
+ */
+static size_t recheader(char *buf, int timest, sl_log_t *log, sl_loglevel_e lvl){
+    size_t l = 0;
+    const char *p = log->addprefix ? lvlprefix(lvl) : NULL;
+    if(p) l = sprintf(buf, "%s\t", p);
+    if(timest) l += logtime(buf + l, log->usec);
+    buf[l++] = '\t';
+    return l;
+}
+
+// wake writer when queue is half-full (missed wakeup only delays writing till timeout)
+static void wakewriter(sl_logasync_t *a){
+    pthread_cond_signal(&a->cond);
+}
+
+// pthread_key destructor: thread exits, its queue will be freed by writer
+static void thrbufexit(void *p){
+    __atomic_store_n(&((logthrbuf_t*)p)->dead, 1, __ATOMIC_RELEASE);
+}
+
+static void freethrbuf(logthrbuf_t *t){
+    sl_RB_delete(&t->rb);
+    FREE(t->buf);
+    FREE(t);
+}
+
+// get queue of current thread (create new for first record)
+static logthrbuf_t *getthrbuf(sl_logasync_t *a){
+    logthrbuf_t *t = pthread_getspecific(a->key);
+    if(t) return t;
+    t = MALLOC(logthrbuf_t, 1);
+    t->rb = sl_RB_new_spsc(a->qsize);
+    t->bufsz = LOG_MINBUF;
+    t->buf = MALLOC(char, LOG_MINBUF);
+    pthread_mutex_lock(&a->regmutex);
+    if(a->nbufs == a->bufsalloc){
+        a->bufsalloc += 8;
+        a->bufs = realloc(a->bufs, a->bufsalloc * sizeof(logthrbuf_t*));
+        if(!a->bufs) ERR("realloc()");
+    }
+    a->bufs[a->nbufs++] = t;
+    pthread_mutex_unlock(&a->regmutex);
+    pthread_setspecific(a->key, t);
+    return t;
+}
+
+// opened log file
+typedef struct sl_logfile{
+    pthread_rwlock_t lock;  // read - to write records, write - to reopen file
+    dev_t dev;              // device and inode of opened file
+    ino_t ino;
+    size_t size;            // size of file
+    uint64_t opened;        // time of opening (CLOCK_MONOTONIC, ns)
+    uint64_t checked;       // time of last check of file name
+    size_t maxsize;         // rotate when size reaches this value (0 - never)
+    uint64_t rotint;        // rotate file of this age, ns (0 - never)
+    int nfiles;             // amount of old files to keep
+    int compress;           // !=0 to gzip old files
+    pthread_t gzthread;     // thread compressing last rotated file
+    int gzrunning;          // ==1 if `gzthread` should be joined
+} sl_logfile_t;
+
+static uint64_t lognow(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// create thread which won't get signals of process
+static int logthread(pthread_t *thr, void *(*fn)(void*), void *arg){
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    int e = pthread_create(thr, NULL, fn, arg);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    return !e;
+}
+
+// open log file (reopened file gets the same descriptor)
+static int logopen(sl_log_t *log){
+    sl_logfile_t *f = log->file;
+    int fd = open(log->logpath, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if(fd < 0) return 0;
+    if(log->fd < 0) log->fd = fd;
+    else{
+        dup3(fd, log->fd, O_CLOEXEC);
+        close(fd);
+    }
+    struct stat st;
+    if(0 == fstat(log->fd, &st)){
+        f->dev = st.st_dev;
+        f->ino = st.st_ino;
+        __atomic_store_n(&f->size, st.st_size, __ATOMIC_RELAXED);
+    }
+    uint64_t now = lognow();
+    __atomic_store_n(&f->opened, now, __ATOMIC_RELAXED);
+    __atomic_store_n(&f->checked, now, __ATOMIC_RELAXED);
+    return 1;
+}
+
+// write data into file (with lock for other processes)
+static ssize_t filewritev(sl_log_t *log, const struct iovec *iov, int n){
+    flock(log->fd, LOCK_EX);
+    ssize_t w = writev(log->fd, iov, n);
+    flock(log->fd, LOCK_UN);
+    if(w > 0) __atomic_add_fetch(&log->file->size, w, __ATOMIC_RELAXED);
+    return w;
+}
+
+static void logcheck(sl_log_t *log);
+
+/**
+ * @brief logwritev - write data into log file
+ * @param log - log
+ * @param iov, n - data
+ * @param check - !=0 to rotate file or reopen moved file before writing
+ * @return amount of bytes written or -1
+ */
+static ssize_t logwritev(sl_log_t *log, const struct iovec *iov, int n, int check){
+    if(check) logcheck(log);
+    pthread_rwlock_rdlock(&log->file->lock);
+    ssize_t w = filewritev(log, iov, n);
+    pthread_rwlock_unlock(&log->file->lock);
+    return w;
+}
+
+/*
+ * Binary log: each file starts with BINLOG_SESSION record, after it follow BINLOG_FORMAT records
+ * (format string got new ID) and BINLOG_RECORD records (format ID and raw arguments). Data is in
+ * host byte order, so decode log on machine of the same architecture.
+ */
+// types of binary records
+enum{
+    BINLOG_SESSION, // log opened; payload - BINLOG_MAGIC and CLOCK_REALTIME (ns) at time `ts`
+    BINLOG_FORMAT,  // new format with ID `id`; payload - format string with trailing zero
+    BINLOG_RECORD,  // record; payload - packed arguments of format `id`
+    BINLOG_TEXT     // record with unsupported format; payload - formatted message
+};
+#define BINLOG_MAGIC    "SLBINLOG"
+// flags of session record
+#define BINLOG_FPREFIX  (1)
+#define BINLOG_FUSEC    (2)
+// max amount of different formats and of arguments in one format
+#define BINLOG_MAXFMTS  (4096)
+#define BINLOG_MAXARGS  (32)
+
+// header of each binary record
+typedef struct{
+    uint32_t len;           // full length of record including header
+    uint32_t id;            // format ID
+    uint64_t ts;            // CLOCK_MONOTONIC, ns
+    uint8_t type;           // BINLOG_*
+    uint8_t level;          // sl_loglevel_e
+    uint8_t timest;         // !=0 to show time of record
+    uint8_t flags;          // BINLOG_F* of session
+    uint32_t reserved;
+} binhdr_t;
+
+typedef struct{
+    binhdr_t hdr;
+    char magic[8];          // BINLOG_MAGIC without trailing zero
+    uint64_t realtime;      // CLOCK_REALTIME (ns) at time `hdr.ts`
+} binsession_t;
+
+// types of arguments; integers are packed as int64_t
+enum{
+    BA_INT,
+    BA_LONG,
+    BA_LLONG,
+    BA_SIZE,
+    BA_INTMAX,
+    BA_PTRDIFF,
+    BA_PTR,
+    BA_DOUBLE,
+    BA_LDOUBLE,
+    BA_STR                  // uint32_t length (UINT32_MAX for NULL) and characters
+};
+
+// format known by binary log
+typedef struct{
+    const char *fmtptr;     // pointer given by user
+    char *fmt;              // copy of format
+    uint32_t id;            // its ID
+    int nargs;              // amount of arguments or -1 if format is unsupported
+    uint8_t types[BINLOG_MAXARGS];
+} logfmt_t;
+
+typedef struct sl_logbin{
+    pthread_mutex_t mutex;  // protects adding of formats and `defs`
+    logfmt_t *slots[2 * BINLOG_MAXFMTS]; // hash table of formats by pointer
+    logfmt_t *byid[BINLOG_MAXFMTS];
+    uint32_t nfmts;         // amount of formats
+    char *defs;             // asynchronous log: BINLOG_FORMAT records to write
+    size_t deflen;          // their length
+    size_t defsz;           // size of `defs`
+} sl_logbin_t;
+
+/**
+ * @brief convspec - parse printf conversion specification
+ * @param p - pointer to '%'
+ * @param end (o) - first symbol after specification
+ * @return type of argument (BA_*), -2 for "%%" or -1 if unsupported ('*', %n, %m, wide chars etc)
+ */
+static int convspec(const char *p, const char **end){
+    ++p;
+    if(*p == '%'){
+        *end = p + 1;
+        return -2;
+    }
+    p += strspn(p, "-+ #0'");
+    p += strspn(p, "0123456789");
+    if(*p == '.'){
+        ++p;
+        p += strspn(p, "0123456789");
+    }
+    int nl = 0; // amount of 'l'
+    char mod = 0;
+    if(*p == 'h'){ // char and short are promoted to int
+        if(*++p == 'h') ++p;
+    }else if(*p == 'l'){
+        nl = 1;
+        if(*++p == 'l'){ ++p; nl = 2; }
+    }else if(*p && strchr("Lqjzt", *p)) mod = *p++;
+    char c = *p;
+    *end = c ? p + 1 : p;
+    switch(c){
+        case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+            switch(mod){
+                case 'j': return BA_INTMAX;
+                case 'z': return BA_SIZE;
+                case 't': return BA_PTRDIFF;
+                case 'q': return BA_LLONG;
+                case 'L': return -1;
+                default: return (nl == 2) ? BA_LLONG : (nl ? BA_LONG : BA_INT);
+            }
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            if(mod == 'L') return BA_LDOUBLE;
+            return mod ? -1 : BA_DOUBLE;
+        case 'c':
+            return (nl || mod) ? -1 : BA_INT;
+        case 's':
+            return (nl || mod) ? -1 : BA_STR;
+        case 'p':
+            return (nl || mod) ? -1 : BA_PTR;
+        default:
+            return -1;
+    }
+}
+
+// fill `f->types` and `f->nargs`
+static void parsefmt(logfmt_t *f){
+    f->nargs = 0;
+    const char *p = f->fmt;
+    while((p = strchr(p, '%'))){
+        int t = convspec(p, &p);
+        if(t == -2) continue;
+        if(t < 0 || f->nargs == BINLOG_MAXARGS){
+            f->nargs = -1;
+            return;
+        }
+        f->types[f->nargs++] = (uint8_t)t;
+    }
+}
+
+#define PUTARG(v)  do{if(buf) memcpy(buf + l, &v, sizeof(v)); l += sizeof(v);}while(0)
+/**
+ * @brief packargs - pack arguments of format
+ * @param buf - buffer for data (NULL to calculate size only)
+ * @param f - format
+ * @param ap - arguments
+ * @return size of data
+ */
+static size_t packargs(char *buf, const logfmt_t *f, va_list ap){
+    size_t l = 0;
+    for(int i = 0; i < f->nargs; ++i){
+        int64_t iv;
+        switch(f->types[i]){
+            case BA_INT: iv = va_arg(ap, int); PUTARG(iv); break;
+            case BA_LONG: iv = va_arg(ap, long); PUTARG(iv); break;
+            case BA_LLONG: iv = va_arg(ap, long long); PUTARG(iv); break;
+            case BA_SIZE: iv = (int64_t)va_arg(ap, size_t); PUTARG(iv); break;
+            case BA_INTMAX: iv = va_arg(ap, intmax_t); PUTARG(iv); break;
+            case BA_PTRDIFF: iv = va_arg(ap, ptrdiff_t); PUTARG(iv); break;
+            case BA_PTR: iv = (int64_t)(intptr_t)va_arg(ap, void*); PUTARG(iv); break;
+            case BA_DOUBLE:{
+                double d = va_arg(ap, double);
+                PUTARG(d);
+            }
+            break;
+            case BA_LDOUBLE:{
+                long double d = va_arg(ap, long double);
+                PUTARG(d);
+            }
+            break;
+            case BA_STR:{
+                const char *s = va_arg(ap, const char*);
+                uint32_t sl = s ? (uint32_t)strlen(s) : UINT32_MAX;
+                PUTARG(sl);
+                if(!s) break;
+                if(buf) memcpy(buf + l, s, sl);
+                l += sl;
+            }
+            break;
+        }
+    }
+    return l;
+}
+#undef PUTARG
+
+static void binheader(binhdr_t *h, int type, sl_loglevel_e lvl, int timest){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    memset(h, 0, sizeof(binhdr_t));
+    h->ts = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    h->type = (uint8_t)type;
+    h->level = (uint8_t)lvl;
+    h->timest = (uint8_t)timest;
+}
+
+// start binary log (or new file of it)
+static int binsession(sl_log_t *log){
+    binsession_t s;
+    struct timespec ts;
+    binheader(&s.hdr, BINLOG_SESSION, 0, 0);
+    clock_gettime(CLOCK_REALTIME, &ts);
+    s.hdr.len = sizeof(s);
+    s.hdr.flags = (log->addprefix ? BINLOG_FPREFIX : 0) | (log->usec ? BINLOG_FUSEC : 0);
+    memcpy(s.magic, BINLOG_MAGIC, sizeof(s.magic));
+    s.realtime = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    struct iovec iov = {.iov_base = &s, .iov_len = sizeof(s)};
+    return (filewritev(log, &iov, 1) == sizeof(s));
+}
+
+// header of BINLOG_FORMAT record; return length of format with trailing zero
+static size_t defheader(binhdr_t *h, const logfmt_t *f){
+    size_t fl = strlen(f->fmt) + 1;
+    binheader(h, BINLOG_FORMAT, 0, 0);
+    h->len = sizeof(binhdr_t) + fl;
+    h->id = f->id;
+    return fl;
+}
+
+// BINLOG_FORMAT record should be in file before any record with this ID
+static void bindef(sl_log_t *log, logfmt_t *f){
+    sl_logbin_t *b = log->bin;
+    binhdr_t h;
+    size_t fl = defheader(&h, f);
+    if(!log->async){ // don't rotate here: rotation writes all formats without `b->mutex`
+        struct iovec iov[2] = {{.iov_base = &h, .iov_len = sizeof(h)}, {.iov_base = f->fmt, .iov_len = fl}};
+        logwritev(log, iov, 2, 0);
+        return;
+    }
+    if(b->deflen + h.len > b->defsz){ // writer will put it before records of threads' queues
+        b->defsz = b->deflen + h.len + LOG_MINBUF;
+        b->defs = realloc(b->defs, b->defsz);
+        if(!b->defs) ERR("realloc()");
+    }
+    memcpy(b->defs + b->deflen, &h, sizeof(h));
+    memcpy(b->defs + b->deflen + sizeof(h), f->fmt, fl);
+    b->deflen += h.len;
+}
+
+// write formats of asynchronous binary log added after last call
+static void bindefs_flush(sl_log_t *log){
+    sl_logbin_t *b = log->bin;
+    pthread_mutex_lock(&b->mutex);
+    struct iovec iov = {.iov_base = b->defs, .iov_len = b->deflen};
+    if(b->deflen && logwritev(log, &iov, 1, 0) > 0) b->deflen = 0;
+    pthread_mutex_unlock(&b->mutex);
+}
+
+static inline uint32_t fmthash(const char *fmt){
+    return (uint32_t)(((uint64_t)(uintptr_t)fmt * 0x9E3779B97F4A7C15ULL) >> 32) & (2 * BINLOG_MAXFMTS - 1);
+}
+
+/**
+ * @brief getfmt - find format by pointer or add it
+ * @param log - binary log
+ * @param fmt - format
+ * @return format or NULL if there's no place for it or pointer was reused for another format
+ */
+static logfmt_t *getfmt(sl_log_t *log, const char *fmt){
+    sl_logbin_t *b = log->bin;
+    uint32_t i = fmthash(fmt);
+    logfmt_t *f;
+    while((f = __atomic_load_n(&b->slots[i], __ATOMIC_ACQUIRE))){ // formats are added but not removed
+        if(f->fmtptr == fmt) return strcmp(f->fmt, fmt) ? NULL : f;
+        i = (i + 1) & (2 * BINLOG_MAXFMTS - 1);
+    }
+    pthread_mutex_lock(&b->mutex);
+    while((f = b->slots[i])){ // other thread could add it
+        if(f->fmtptr == fmt){
+            pthread_mutex_unlock(&b->mutex);
+            return strcmp(f->fmt, fmt) ? NULL : f;
+        }
+        i = (i + 1) & (2 * BINLOG_MAXFMTS - 1);
+    }
+    if(b->nfmts < BINLOG_MAXFMTS){
+        f = MALLOC(logfmt_t, 1);
+        f->fmtptr = fmt;
+        f->fmt = strdup(fmt);
+        f->id = b->nfmts;
+        parsefmt(f);
+        b->byid[b->nfmts] = f;
+        __atomic_store_n(&b->nfmts, b->nfmts + 1, __ATOMIC_RELEASE); // for bindefs_all()
+        if(f->nargs > -1) bindef(log, f);
+        __atomic_store_n(&b->slots[i], f, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&b->mutex);
+    return f;
+}
+
+static void freebin(sl_logbin_t *b){
+    for(uint32_t i = 0; i < b->nfmts; ++i){
+        FREE(b->byid[i]->fmt);
+        FREE(b->byid[i]);
+    }
+    FREE(b->defs);
+    pthread_mutex_destroy(&b->mutex);
+    FREE(b);
+}
+
+// write all known formats into new file of binary log
+static void bindefs_all(sl_log_t *log){
+    sl_logbin_t *b = log->bin;
+    uint32_t n = __atomic_load_n(&b->nfmts, __ATOMIC_ACQUIRE);
+    for(uint32_t i = 0; i < n; ++i){
+        logfmt_t *f = b->byid[i];
+        if(f->nargs < 0) continue;
+        binhdr_t h;
+        size_t fl = defheader(&h, f);
+        struct iovec iov[2] = {{.iov_base = &h, .iov_len = sizeof(h)}, {.iov_base = f->fmt, .iov_len = fl}};
+        filewritev(log, iov, 2);
+    }
+}
+
+// reopen log file; binary log starts new session
+static int logreopen(sl_log_t *log){
+    if(!logopen(log)) return 0;
+    if(log->bin){
+        binsession(log);
+        bindefs_all(log);
+    }
+    return 1;
+}
+
+extern char **environ;
+// compress rotated file
+static void *gzipthread(void *arg){
+    char *path = (char*)arg;
+    char *argv[] = {"gzip", "-f", path, NULL};
+    posix_spawnattr_t attr;
+    sigset_t none;
+    sigemptyset(&none);
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setsigmask(&attr, &none);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+    pid_t pid;
+    if(posix_spawnp(&pid, "gzip", NULL, &attr, argv, environ)) WARNX(_("Can't run gzip"));
+    else waitpid(pid, NULL, 0);
+    posix_spawnattr_destroy(&attr);
+    FREE(path);
+    return NULL;
+}
+
+// rename log -> log.1 -> log.2 ... log.N (removed), open new file
+static void logrotate(sl_log_t *log){
+    sl_logfile_t *f = log->file;
+    if(f->gzrunning){ // don't rename file which is compressed now
+        pthread_join(f->gzthread, NULL);
+        f->gzrunning = 0;
+    }
+    size_t l = strlen(log->logpath) + 32;
+    char *o = MALLOC(char, l), *n = MALLOC(char, l);
+    for(int i = f->nfiles; i > 0; --i) for(int gz = 0; gz < 2; ++gz){
+        const char *sfx = gz ? ".gz" : "";
+        snprintf(n, l, "%s.%d%s", log->logpath, i, sfx);
+        if(i == f->nfiles) unlink(n);
+        if(i == 1) continue;
+        snprintf(o, l, "%s.%d%s", log->logpath, i - 1, sfx);
+        rename(o, n);
+    }
+    snprintf(n, l, "%s.1", log->logpath);
+    if(rename(log->logpath, n)) WARN(_("Can't rotate log %s"), log->logpath);
+    else if(!logreopen(log)) WARN(_("Can't open log file"));
+    else if(f->compress){
+        if(logthread(&f->gzthread, gzipthread, n)){
+            f->gzrunning = 1;
+            n = NULL;
+        }
+    }
+    FREE(o);
+    FREE(n);
+}
+
+static int needrotate(sl_logfile_t *f, uint64_t now){
+    if(f->maxsize && __atomic_load_n(&f->size, __ATOMIC_RELAXED) >= f->maxsize) return 1;
+    if(f->rotint && now - __atomic_load_n(&f->opened, __ATOMIC_RELAXED) >= f->rotint) return 1;
+    return 0;
+}
+
+// rotate file if it is too large or too old; reopen it if it was moved or removed by somebody
+static void logcheck(sl_log_t *log){
+    sl_logfile_t *f = log->file;
+    uint64_t now = lognow();
+    if(!needrotate(f, now) && now - __atomic_load_n(&f->checked, __ATOMIC_RELAXED) < 1000000000ULL) return;
+    pthread_rwlock_wrlock(&f->lock);
+    int rot = needrotate(f, now); // other thread could rotate file while we waited
+    if(rot || now - __atomic_load_n(&f->checked, __ATOMIC_RELAXED) >= 1000000000ULL){
+        struct stat st;
+        if(stat(log->logpath, &st) || st.st_dev != f->dev || st.st_ino != f->ino) logreopen(log);
+        else if(rot) logrotate(log);
+        else __atomic_store_n(&f->size, st.st_size, __ATOMIC_RELAXED); // other processes write too
+        __atomic_store_n(&f->checked, now, __ATOMIC_RELAXED);
+    }
+    pthread_rwlock_unlock(&f->lock);
+}
+
+// lock mutex; if !wait give up after 0.1s (can't wait in signal handler)
+static int loglock(pthread_mutex_t *m, int wait){
+    if(wait) return !pthread_mutex_lock(m);
+    double t0 = sl_dtime();
+    while(pthread_mutex_trylock(m)){
+        if(sl_dtime() - t0 > 0.1) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief logdrain - write all queued records into log file
+ * @param log - asynchronous log
+ * @param wait - ==0 if called from signal handler: don't wait for locks, don't format messages
+ * @return amount of bytes written or -1 if can't
+ */
+static ssize_t logdrain(sl_log_t *log, int wait){
+    sl_logasync_t *a = log->async;
+    if(!loglock(&a->drainmutex, wait)) return -1;
+    if(!loglock(&a->regmutex, wait)){
+        pthread_mutex_unlock(&a->drainmutex);
+        return -1;
+    }
+    ssize_t total = 0;
+    size_t d = __atomic_load_n(&a->dropped, __ATOMIC_RELAXED);
+    if(wait && d != a->dreported){
+        char s[LOG_MINBUF];
+        binhdr_t h;
+        size_t l = log->bin ? sizeof(h) : recheader(s, 1, log, LOGLEVEL_WARN);
+        l += snprintf(s + l, LOG_MINBUF - l, "%zu log records dropped\n", d - a->dreported);
+        if(log->bin){
+            binheader(&h, BINLOG_TEXT, LOGLEVEL_WARN, 1);
+            h.len = l;
+            memcpy(s, &h, sizeof(h));
+        }
+        struct iovec iov = {.iov_base = s, .iov_len = l};
+        if(logwritev(log, &iov, 1, 1) > 0) a->dreported = d;
+    }
+    for(int i = 0; i < a->nbufs;){
+        struct iovec iov[LOG_IOVMAX];
+        logthrbuf_t *t[LOG_IOVMAX / 2];
+        size_t len[LOG_IOVMAX / 2];
+        int niov = 0, nt = 0;
+        for(; i < a->nbufs && niov < LOG_IOVMAX - 1; ++i){
+            int n = sl_RB_peek(a->bufs[i]->rb, iov + niov);
+            if(!n) continue;
+            len[nt] = 0;
+            for(int j = 0; j < n; ++j) len[nt] += iov[niov + j].iov_len;
+            t[nt++] = a->bufs[i];
+            niov += n;
+        }
+        if(!niov) break;
+        if(log->bin) bindefs_flush(log); // formats of records peeked are already here
+        ssize_t w = logwritev(log, iov, niov, wait); // can't rotate in signal handler
+        if(w <= 0) break; // leave records in queues
+        total += w;
+        for(int k = 0; k < nt && w > 0; ++k){
+            size_t c = ((size_t)w < len[k]) ? (size_t)w : len[k];
+            sl_RB_consume(t[k]->rb, c);
+            w -= c;
+        }
+    }
+    if(wait) for(int i = 0; i < a->nbufs;){ // free queues of exited threads
+        logthrbuf_t *t = a->bufs[i];
+        if(__atomic_load_n(&t->dead, __ATOMIC_ACQUIRE) && 0 == sl_RB_datalen(t->rb)){
+            freethrbuf(t);
+            a->bufs[i] = a->bufs[--a->nbufs];
+        }else ++i;
+    }
+    pthread_mutex_unlock(&a->regmutex);
+    pthread_mutex_unlock(&a->drainmutex);
+    return total;
+}
+
+static void *logwriter(void *arg){
+    sl_log_t *log = (sl_log_t*)arg;
+    sl_logasync_t *a = log->async;
+    pthread_mutex_lock(&a->cmutex);
+    while(!a->stop){
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        double t = ts.tv_nsec / 1e9 + a->flushint;
+        ts.tv_sec += (time_t)t;
+        ts.tv_nsec = (long)((t - floor(t)) * 1e9);
+        pthread_cond_timedwait(&a->cond, &a->cmutex, &ts);
+        if(a->stop) break;
+        pthread_mutex_unlock(&a->cmutex);
+        logdrain(log, 1);
+        pthread_mutex_lock(&a->cmutex);
+    }
+    pthread_mutex_unlock(&a->cmutex);
+    return NULL;
+}
+
+// flush asynchronous logs at exit() (e.g. from `signals`)
+static void flushasynclogs(){
+    if(pthread_mutex_trylock(&asynclogs_mutex)) return;
+    for(int i = 0; i < nasynclogs; ++i) logdrain(asynclogs[i], 0);
+    pthread_mutex_unlock(&asynclogs_mutex);
+}
+
+static void destroyasync(sl_logasync_t *a){
+    pthread_key_delete(a->key);
+    pthread_mutex_destroy(&a->regmutex);
+    pthread_mutex_destroy(&a->drainmutex);
+    pthread_mutex_destroy(&a->cmutex);
+    pthread_cond_destroy(&a->cond);
+    FREE(a);
+}
+
+// run writer thread
+static int initasync(sl_log_t *log, const sl_logopts_t *opts){
+    sl_logasync_t *a = MALLOC(sl_logasync_t, 1);
+    a->qsize = opts->queuesize ? opts->queuesize : SL_DEF_LOGQSIZE;
+    if(a->qsize < LOG_MINQSIZE) a->qsize = LOG_MINQSIZE;
+    a->flushint = (opts->flushint > 0.) ? opts->flushint : SL_DEF_LOGFLUSHINT;
+    if(pthread_key_create(&a->key, thrbufexit)){
+        WARN("pthread_key_create()");
+        FREE(a);
+        return 0;
+    }
+    pthread_mutex_init(&a->regmutex, NULL);
+    pthread_mutex_init(&a->drainmutex, NULL);
+    pthread_mutex_init(&a->cmutex, NULL);
+    pthread_condattr_t cattr;
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&a->cond, &cattr);
+    pthread_condattr_destroy(&cattr);
+    log->async = a;
+    // signals should be handled by other threads: writer may hold locks needed by sl_flushlog()
+    if(!logthread(&a->writer, logwriter, log)){
+        WARNX("pthread_create()");
+        destroyasync(a);
+        log->async = NULL;
+        return 0;
+    }
+    pthread_mutex_lock(&asynclogs_mutex);
+    if(!asynclogs) atexit(flushasynclogs);
+    if(nasynclogs == asynclogsalloc){
+        asynclogsalloc += 4;
+        asynclogs = realloc(asynclogs, asynclogsalloc * sizeof(sl_log_t*));
+        if(!asynclogs) ERR("realloc()");
+    }
+    asynclogs[nasynclogs++] = log;
+    pthread_mutex_unlock(&asynclogs_mutex);
+    return 1;
+}
+
+// stop writer, write the rest of records and free all
+static void freeasync(sl_log_t *log){
+    sl_logasync_t *a = log->async;
+    pthread_mutex_lock(&asynclogs_mutex);
+    for(int i = 0; i < nasynclogs; ++i) if(asynclogs[i] == log){
+        asynclogs[i] = asynclogs[--nasynclogs];
+        break;
+    }
+    pthread_mutex_unlock(&asynclogs_mutex);
+    pthread_mutex_lock(&a->cmutex);
+    a->stop = 1;
+    pthread_cond_signal(&a->cond);
+    pthread_mutex_unlock(&a->cmutex);
+    pthread_join(a->writer, NULL);
+    logdrain(log, 1);
+    for(int i = 0; i < a->nbufs; ++i) freethrbuf(a->bufs[i]);
+    FREE(a->bufs);
+    destroyasync(a);
+    log->async = NULL;
+}
+
 /**
  * @brief sl_createlog - create log file, test file open ability
  * @param logpath - path to log file
@@ -486,14 +1369,25 @@ sl_log_t *sl_globlog = NULL; // "global" log file (the first opened logfile)
  * @return allocated structure (should be free'd later by Cl_deletelog) or NULL
  */
 sl_log_t *sl_createlog(const char *logpath, sl_loglevel_e level, int prefix){
+    return sl_createlog_ext(logpath, level, prefix, NULL);
+}
+
+/**
+ * @brief sl_createlog_ext - create log with additional parameters
+ * @param logpath - path to log file
+ * @param level   - lowest message level
+ * @param prefix  - !=0 to add record type to each line
+ * @param opts    - parameters (NULL - like sl_createlog): `usec` adds microseconds to timestamps;
+ *                  if `async`, records are formatted into lock-free queue of each thread and written
+ *                  by background thread into file opened once; records that don't fit into queue
+ *                  are dropped and counted; `binary` - write format ID, time and raw arguments
+ *                  instead of text (see sl_decodelog); `maxsize`/`rotint` - rotate file keeping
+ *                  `nfiles` old files (gzipped if `compress`)
+ * @return allocated structure (should be free'd later by sl_deletelog) or NULL
+ */
+sl_log_t *sl_createlog_ext(const char *logpath, sl_loglevel_e level, int prefix, const sl_logopts_t *opts){
     if(level < LOGLEVEL_NONE || level > LOGLEVEL_ANY) return NULL;
     if(!logpath) return NULL;
-    FILE *logfd = fopen(logpath, "a");
-    if(!logfd){
-        WARN("Can't open log file");
-        return NULL;
-    }
-    fclose(logfd);
     sl_log_t *log = MALLOC(sl_log_t, 1);
     log->logpath = strdup(logpath);
     if(!log->logpath){
@@ -503,78 +1397,381 @@ sl_log_t *sl_createlog(const char *logpath, sl_loglevel_e level, int prefix){
     }
     log->loglevel = level;
     log->addprefix = prefix;
+    log->fd = -1;
+    log->file = MALLOC(sl_logfile_t, 1);
+    pthread_rwlock_init(&log->file->lock, NULL);
+    if(opts){
+        log->usec = opts->usec;
+        log->file->maxsize = opts->maxsize;
+        if(opts->rotint > 0.) log->file->rotint = (uint64_t)(opts->rotint * 1e9);
+        log->file->nfiles = (opts->nfiles > 0) ? opts->nfiles : SL_DEF_LOGNFILES;
+        log->file->compress = opts->compress;
+    }
+    if(!logopen(log)){
+        WARN("Can't open log file");
+        goto bad;
+    }
+    if(opts && opts->binary){
+        log->bin = MALLOC(sl_logbin_t, 1);
+        pthread_mutex_init(&log->bin->mutex, NULL);
+        if(!binsession(log)){
+            WARN("Can't write log file");
+            goto bad;
+        }
+    }
+    if(opts && opts->async && !initasync(log, opts)) goto bad;
     return log;
+bad:
+    if(log->bin) freebin(log->bin);
+    if(log->fd > -1) close(log->fd);
+    pthread_rwlock_destroy(&log->file->lock);
+    FREE(log->file);
+    FREE(log->logpath);
+    FREE(log);
+    return NULL;
 }
 
+/**
+ * @brief sl_deletelog - close log (asynchronous log writes all queued records before)
+ *        nobody should write into this log while it is deleted
+ * @param log - log to delete
+ */
 void sl_deletelog(sl_log_t **log){
     if(!log || !*log) return;
+    if((*log)->async) freeasync(*log);
+    if((*log)->bin) freebin((*log)->bin);
+    sl_logfile_t *f = (*log)->file;
+    if(f->gzrunning) pthread_join(f->gzthread, NULL);
+    pthread_rwlock_destroy(&f->lock);
+    FREE((*log)->file);
+    close((*log)->fd);
     FREE((*log)->logpath);
     FREE(*log);
 }
 
 /**
- * @brief sl_putlog - put message to log file with/without timestamp
- * @param timest - ==1 to put timestamp
- * @param log - pointer to log structure
- * @param lvl - message loglevel (if lvl > loglevel, message won't be printed)
- * @param fmt - format and the rest part of message
- * @return amount of symbols saved in file
+ * @brief sl_flushlog - write all queued records of asynchronous log right now
+ *        (can be called in signal handler; asynchronous logs are also flushed at exit())
+ * @param log - log
+ * @return amount of bytes written, 0 for synchronous log or -1 if queues are busy
  */
-int sl_putlogt(int timest, sl_log_t *log, sl_loglevel_e lvl, const char *fmt, ...){
-    if(!log || !log->logpath) return 0;
-    if(lvl > log->loglevel) return 0;
-    int i = 0;
-    FILE *logfd = fopen(log->logpath, "a+");
-    if(!logfd) return 0;
-    int lfd = fileno(logfd);
-    // try to lock file
-    double t0 = sl_dtime();
-    int locked = 0;
-    while(sl_dtime() - t0 < 0.1){ // timeout for 0.1s
-        if(-1 == flock(lfd, LOCK_EX | LOCK_NB)) continue;
-        locked = 1;
-        break;
+ssize_t sl_flushlog(sl_log_t *log){
+    if(!log || !log->async) return 0;
+    return logdrain(log, 0);
+}
+
+/**
+ * @brief sl_log_dropped - amount of records of asynchronous log dropped due to queue overflow
+ * @param log - log
+ * @return amount of dropped records
+ */
+size_t sl_log_dropped(sl_log_t *log){
+    if(!log || !log->async) return 0;
+    return __atomic_load_n(&log->async->dropped, __ATOMIC_RELAXED);
+}
+
+#define GETARG(v)  do{if(a + sizeof(v) > aend) goto bad; memcpy(&v, a, sizeof(v)); a += sizeof(v);}while(0)
+/**
+ * @brief unpackargs - print message of binary record
+ * @param out - output stream
+ * @param f - format
+ * @param a - packed arguments
+ * @param alen - their length
+ * @return 0 if all OK or 1 if arguments are broken
+ */
+static int unpackargs(FILE *out, const logfmt_t *f, const char *a, size_t alen){
+    const char *aend = a + alen, *p = f->fmt, *pc;
+    char spec[64];
+    while((pc = strchr(p, '%'))){
+        fwrite(p, 1, pc - p, out);
+        int t = convspec(pc, &p);
+        if(t == -2){
+            fputc('%', out);
+            continue;
+        }
+        size_t sl = p - pc;
+        if(sl >= sizeof(spec)) goto bad;
+        memcpy(spec, pc, sl);
+        spec[sl] = 0;
+        if(t == BA_STR){
+            uint32_t l;
+            GETARG(l);
+            if(l == UINT32_MAX){
+                fprintf(out, spec, (char*)NULL);
+                continue;
+            }
+            if(a + l > aend) goto bad;
+            char *s = strndup(a, l);
+            fprintf(out, spec, s);
+            free(s);
+            a += l;
+        }else if(t == BA_DOUBLE){
+            double d;
+            GETARG(d);
+            fprintf(out, spec, d);
+        }else if(t == BA_LDOUBLE){
+            long double d;
+            GETARG(d);
+            fprintf(out, spec, d);
+        }else{
+            int64_t v;
+            GETARG(v);
+            switch(t){
+                case BA_INT: fprintf(out, spec, (int)v); break;
+                case BA_LONG: fprintf(out, spec, (long)v); break;
+                case BA_LLONG: fprintf(out, spec, (long long)v); break;
+                case BA_SIZE: fprintf(out, spec, (size_t)v); break;
+                case BA_INTMAX: fprintf(out, spec, (intmax_t)v); break;
+                case BA_PTRDIFF: fprintf(out, spec, (ptrdiff_t)v); break;
+                default: fprintf(out, spec, (void*)(intptr_t)v);
+            }
+        }
     }
-    if(!locked) return 0; // can't lock
-    if(log->addprefix){
-        const char *p;
-        switch(lvl){
-            case LOGLEVEL_ERR:
-                p = "[ERR]";
+    fputs(p, out);
+    return 0;
+bad:
+    return 1;
+}
+#undef GETARG
+
+/**
+ * @brief sl_decodelog - convert binary log into text log: "[LEVEL]\tYYYY/mm/dd-HH:MM:SS\tmessage"
+ * @param binlog - path to binary log
+ * @param out - output stream
+ * @return amount of records converted or -1 if file isn't binary log
+ */
+ssize_t sl_decodelog(const char *binlog, FILE *out){
+    if(!binlog || !out) return -1;
+    FILE *in = fopen(binlog, "r");
+    if(!in){
+        WARN("Can't open %s", binlog);
+        return -1;
+    }
+    ssize_t nrec = 0;
+    binhdr_t h;
+    char *buf = NULL, *msg = NULL;
+    size_t bufsz = 0, msgsz;
+    logfmt_t **fmts = NULL;
+    uint32_t nfmts = 0;
+    binsession_t s = {0};
+    while(1 == fread(&h, sizeof(h), 1, in)){
+        if(h.len < sizeof(h)){
+            WARNX(_("Broken binary log"));
             break;
-            case LOGLEVEL_WARN:
-                p = "[WARN]";
+        }
+        size_t l = h.len - sizeof(h);
+        if(l + 1 > bufsz){
+            bufsz = l + 1;
+            buf = realloc(buf, bufsz);
+            if(!buf) ERR("realloc()");
+        }
+        if(l && 1 != fread(buf, l, 1, in)){
+            WARNX(_("Broken binary log"));
             break;
-            case LOGLEVEL_MSG:
-                p = "[MSG]";
+        }
+        buf[l] = 0;
+        if(!s.hdr.len && h.type != BINLOG_SESSION) break; // not binary log
+        switch(h.type){
+            case BINLOG_SESSION: // new file or process: formats will be defined again
+                if(l + sizeof(h) != sizeof(s) || memcmp(buf, BINLOG_MAGIC, sizeof(s.magic))){
+                    WARNX(_("Broken binary log"));
+                    goto ret;
+                }
+                memcpy(&s, &h, sizeof(h));
+                memcpy(&s.realtime, buf + sizeof(s.magic), sizeof(s.realtime));
+                for(uint32_t i = 0; i < nfmts; ++i) if(fmts[i]){
+                    FREE(fmts[i]->fmt);
+                    FREE(fmts[i]);
+                }
             break;
-            case LOGLEVEL_DBG:
-                p = "[DBG]";
+            case BINLOG_FORMAT:
+                if(h.id >= BINLOG_MAXFMTS) break;
+                if(h.id >= nfmts){
+                    fmts = realloc(fmts, (h.id + 1) * sizeof(logfmt_t*));
+                    if(!fmts) ERR("realloc()");
+                    memset(fmts + nfmts, 0, (h.id + 1 - nfmts) * sizeof(logfmt_t*));
+                    nfmts = h.id + 1;
+                }else if(fmts[h.id]){
+                    FREE(fmts[h.id]->fmt);
+                    FREE(fmts[h.id]);
+                }
+                fmts[h.id] = MALLOC(logfmt_t, 1);
+                fmts[h.id]->fmt = strdup(buf);
+                parsefmt(fmts[h.id]);
+            break;
+            case BINLOG_RECORD:
+            case BINLOG_TEXT:{
+                FILE *m = open_memstream(&msg, &msgsz);
+                if(!m) ERR("open_memstream()");
+                const char *p = (s.hdr.flags & BINLOG_FPREFIX) ? lvlprefix(h.level) : NULL;
+                if(p) fprintf(m, "%s\t", p);
+                if(h.timest){
+                    uint64_t ns = s.realtime + (h.ts - s.hdr.ts);
+                    time_t sec = (time_t)(ns / 1000000000ULL);
+                    struct tm curtm;
+                    char strtm[LOG_TIMELEN];
+                    localtime_r(&sec, &curtm);
+                    strftime(strtm, LOG_TIMELEN, "%Y/%m/%d-%H:%M:%S", &curtm);
+                    fputs(strtm, m);
+                    if(s.hdr.flags & BINLOG_FUSEC) fprintf(m, ".%06u", (unsigned)((ns / 1000) % 1000000));
+                }
+                fputc('\t', m);
+                int bad = 0;
+                if(h.type == BINLOG_TEXT) fputs(buf, m);
+                else if(h.id >= nfmts || !fmts[h.id] || fmts[h.id]->nargs < 0) bad = 1;
+                else bad = unpackargs(m, fmts[h.id], buf, l);
+                fclose(m);
+                if(bad) WARNX(_("Broken binary record %zd"), nrec);
+                fwrite(msg, 1, msgsz, out);
+                if(msgsz && msg[msgsz - 1] != '\n') fputc('\n', out);
+                FREE(msg);
+                ++nrec;
+            }
             break;
             default:
-                p = NULL;
+                WARNX(_("Unknown binary record type %d"), h.type);
         }
-        if(p) i += fprintf(logfd, "%s\t", p);
     }
-    if(timest){
-        char strtm[128];
-        time_t t = time(NULL);
-        struct tm *curtm = localtime(&t);
-        strftime(strtm, 128, "%Y/%m/%d-%H:%M:%S", curtm);
-        i = fprintf(logfd, "%s", strtm);
+ret:
+    for(uint32_t i = 0; i < nfmts; ++i) if(fmts[i]){
+        FREE(fmts[i]->fmt);
+        FREE(fmts[i]);
+    }
+    FREE(fmts);
+    FREE(buf);
+    fclose(in);
+    if(!s.hdr.len) return -1;
+    return nrec;
+}
+
+// put `len` bytes of thread's buffer into its queue
+static int queuerec(sl_logasync_t *a, logthrbuf_t *t, size_t len){
+    struct iovec iov[2];
+    int n = sl_RB_reserve(t->rb, iov);
+    size_t rest = 0;
+    for(int i = 0; i < n; ++i) rest += iov[i].iov_len;
+    if(rest < len){
+        __atomic_add_fetch(&a->dropped, 1, __ATOMIC_RELAXED);
+        wakewriter(a);
+        return 0;
+    }
+    size_t _1st = (iov[0].iov_len < len) ? iov[0].iov_len : len;
+    memcpy(iov[0].iov_base, t->buf, _1st);
+    if(_1st < len) memcpy(iov[1].iov_base, t->buf + _1st, len - _1st);
+    sl_RB_commit(t->rb, len);
+    if(rest - len < a->qsize / 2) wakewriter(a);
+    return (int)len;
+}
+
+// format record into thread's buffer and put it into queue
+static int putlog_async(int timest, sl_log_t *log, sl_loglevel_e lvl, const char *fmt, va_list ar){
+    sl_logasync_t *a = log->async;
+    logthrbuf_t *t = getthrbuf(a);
+    size_t l = recheader(t->buf, timest, log, lvl);
+    va_list aq;
+    va_copy(aq, ar);
+    int r = vsnprintf(t->buf + l, t->bufsz - l, fmt, aq);
+    va_end(aq);
+    if(r < 0) return 0;
+    size_t len = l + r;
+    if(len + 2 > t->bufsz){ // + '\n' + '\0'
+        size_t sz = len + 2;
+        if(sz > a->qsize) sz = a->qsize; // truncate records larger than queue
+        char *nb = realloc(t->buf, sz);
+        if(!nb) return 0;
+        t->buf = nb;
+        t->bufsz = sz;
+        vsnprintf(t->buf + l, sz - l, fmt, ar);
+        if(len + 2 > sz) len = sz - 2;
+    }
+    if(t->buf[len - 1] != '\n') t->buf[len++] = '\n';
+    return queuerec(a, t, len);
+}
+
+// format record and write it into file
+static int putlog_sync(int timest, sl_log_t *log, sl_loglevel_e lvl, const char *fmt, va_list ar){
+    char stk[4 * LOG_MINBUF], *buf = stk;
+    size_t l = recheader(buf, timest, log, lvl);
+    va_list aq;
+    va_copy(aq, ar);
+    int r = vsnprintf(buf + l, sizeof(stk) - l, fmt, aq);
+    va_end(aq);
+    if(r < 0) return 0;
+    size_t len = l + r;
+    if(len + 2 > sizeof(stk)){ // + '\n' + '\0'
+        buf = MALLOC(char, len + 2);
+        memcpy(buf, stk, l);
+        vsnprintf(buf + l, len + 2 - l, fmt, ar);
+    }
+    if(buf[len - 1] != '\n') buf[len++] = '\n';
+    struct iovec iov = {.iov_base = buf, .iov_len = len};
+    ssize_t w = logwritev(log, &iov, 1, 1);
+    if(buf != stk) FREE(buf);
+    return (w < 0) ? 0 : (int)w;
+}
+
+// pack record into binary form and write it or put into queue
+static int putlog_bin(int timest, sl_log_t *log, sl_loglevel_e lvl, const char *fmt, va_list ar){
+    logfmt_t *f = getfmt(log, fmt);
+    int packed = (f && f->nargs > -1);
+    binhdr_t h;
+    binheader(&h, packed ? BINLOG_RECORD : BINLOG_TEXT, lvl, timest);
+    va_list aq;
+    va_copy(aq, ar);
+    size_t l;
+    if(packed){
+        h.id = f->id;
+        l = packargs(NULL, f, aq);
+    }else{ // format message like text log do
+        int r = vsnprintf(NULL, 0, fmt, aq);
+        l = (r < 0) ? 0 : (size_t)r;
     }
-    i += fprintf(logfd, "\t");
+    va_end(aq);
+    l += sizeof(h);
+    h.len = l;
+    char stk[LOG_MINBUF], *buf = stk;
+    logthrbuf_t *t = NULL;
+    if(log->async){
+        if(l >= log->async->qsize){
+            __atomic_add_fetch(&log->async->dropped, 1, __ATOMIC_RELAXED);
+            return 0;
+        }
+        t = getthrbuf(log->async);
+        if(l + 1 > t->bufsz){
+            char *nb = realloc(t->buf, l + 1);
+            if(!nb) return 0;
+            t->buf = nb;
+            t->bufsz = l + 1;
+        }
+        buf = t->buf;
+    }else if(l + 1 > sizeof(stk)) buf = MALLOC(char, l + 1);
+    memcpy(buf, &h, sizeof(h));
+    if(packed) packargs(buf + sizeof(h), f, ar);
+    else vsnprintf(buf + sizeof(h), l + 1 - sizeof(h), fmt, ar);
+    if(t) return queuerec(log->async, t, l);
+    struct iovec iov = {.iov_base = buf, .iov_len = l};
+    ssize_t w = logwritev(log, &iov, 1, 1);
+    if(buf != stk) FREE(buf);
+    return (w < 0) ? 0 : (int)w;
+}
+
+/**
+ * @brief sl_putlog - put message to log file with/without timestamp
+ * @param timest - ==1 to put timestamp
+ * @param log - pointer to log structure
+ * @param lvl - message loglevel (if lvl > loglevel, message won't be printed)
+ * @param fmt - format and the rest part of message
+ * @return amount of symbols saved in file (or queued for asynchronous log), size of binary record
+ */
+int sl_putlogt(int timest, sl_log_t *log, sl_loglevel_e lvl, const char *fmt, ...){
+    if(!log || !log->logpath) return 0;
+    if(lvl > log->loglevel) return 0;
     va_list ar;
+    int l;
     va_start(ar, fmt);
-    i += vfprintf(logfd, fmt, ar);
+    if(log->bin) l = putlog_bin(timest, log, lvl, fmt, ar);
+    else if(log->async) l = putlog_async(timest, log, lvl, fmt, ar);
+    else l = putlog_sync(timest, log, lvl, fmt, ar);
     va_end(ar);
-    fseek(logfd, -1, SEEK_CUR);
-    char c;
-    ssize_t r = fread(&c, 1, 1, logfd);
-    if(1 == r){ // add '\n' if there was no newline
-        if(c != '\n') i += fprintf(logfd, "\n");
-    }
-    flock(lfd, LOCK_UN);
-    fclose(logfd);
-    return i;
+    return l;
 }
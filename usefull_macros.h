@@ -27,8 +27,10 @@
 #include <errno.h>          // errno
 #include <netdb.h>          // struct addrinfo
 #include <pthread.h>
+#include <stddef.h>         // offsetof
 #include <stdlib.h>         // alloc, free
 #include <sys/types.h>      // pid_t
+#include <sys/uio.h>        // struct iovec
 #include <unistd.h>         // pid_t
 // just for different purposes
 #include <limits.h>
@@ -129,6 +131,33 @@ void *sl_alloc(size_t N, size_t S);
 // setup locales & other
 void sl_init();
 
+/*
+ * Growable arrays: SL_VEC(name, type) declares structure `name_t` (zero-filled means empty) with
+ * fields `data`, `len` and `cap`, and functions:
+ *      name_reserve(v, n)  - make room for `n` items
+ *      name_extend(v, n)   - append `n` uninitialized items, return pointer to the first of them
+ *      name_push(v, val)   - append `val`, return pointer to it
+ *      name_shrink(v)      - free unused capacity
+ *      name_free(v)        - free data
+ * Capacity grows geometrically, so appending is amortized O(1); `data` moves when array grows.
+ */
+// minimal capacity of growable array
+#define SL_VEC_MINCAP   (16)
+void *sl_vec_grow(void *data, size_t *cap, size_t n, size_t S);
+void *sl_vec_shrink(void *data, size_t *cap, size_t len, size_t S);
+#define SL_VEC(name, type)                                                      \
+typedef struct{ type *data; size_t len; size_t cap; } name ## _t;               \
+static inline void name ## _reserve(name ## _t *v, size_t n){                   \
+    if(n > v->cap) v->data = (type *)sl_vec_grow(v->data, &v->cap, n, sizeof(type)); } \
+static inline type *name ## _extend(name ## _t *v, size_t n){                   \
+    name ## _reserve(v, v->len + n); type *p = v->data + v->len; v->len += n; return p; } \
+static inline type *name ## _push(name ## _t *v, type val){                     \
+    type *p = name ## _extend(v, 1); *p = val; return p; }                      \
+static inline void name ## _shrink(name ## _t *v){                              \
+    v->data = (type *)sl_vec_shrink(v->data, &v->cap, v->len, sizeof(type)); }  \
+static inline void name ## _free(name ## _t *v){                                \
+    FREE(v->data); v->len = v->cap = 0; }
+
 // mmap file
 typedef struct{
     char *data;
@@ -136,6 +165,17 @@ typedef struct{
 } sl_mmapbuf_t;
 sl_mmapbuf_t *sl_mmap(char *filename);
 void sl_munmap(sl_mmapbuf_t *b);
+// sequential zero-copy reading of mmap'ed file by records
+typedef struct{
+    sl_mmapbuf_t *buf;      // mapped file
+    size_t pos;             // offset of next record
+    size_t ahead;           // end of area already prefetched
+    size_t lineno;          // number of last record got (from 1)
+    int delim;              // records' delimiter
+} sl_mmapiter_t;
+sl_mmapiter_t *sl_mmap_iter(char *filename, int delim);
+int sl_mmap_next(sl_mmapiter_t *it, const char **rec, size_t *len);
+void sl_mmap_iterfree(sl_mmapiter_t **it);
 
 // console in non-echo mode
 void sl_restore_con();
@@ -196,17 +236,50 @@ typedef enum{
     LOGLEVEL_AMOUNT // total amount
 } sl_loglevel_e;
 
+// default size of per-thread queue of asynchronous log
+#define SL_DEF_LOGQSIZE     (65536)
+// default interval between flushes of asynchronous log, seconds
+#define SL_DEF_LOGFLUSHINT  (0.1)
+// default amount of old log files kept by rotation
+#define SL_DEF_LOGNFILES    (5)
+
+// additional log parameters
+typedef struct{
+    int async;              // !=0 - write records by background thread
+    size_t queuesize;       // size of each thread's queue (bytes), 0 - SL_DEF_LOGQSIZE
+    double flushint;        // max time records wait in queue (seconds), 0 - SL_DEF_LOGFLUSHINT
+    int usec;               // !=0 - add microseconds to timestamps
+    int binary;             // !=0 - write binary records (decode them by sl_decodelog)
+    size_t maxsize;         // rotate log when its size reaches `maxsize` bytes (0 - don't)
+    double rotint;          // rotate log each `rotint` seconds (0 - don't)
+    int nfiles;             // amount of old files (logpath.1 .. logpath.N) to keep, 0 - SL_DEF_LOGNFILES
+    int compress;           // !=0 - compress old files by gzip in background
+} sl_logopts_t;
+
+struct sl_logasync;
+struct sl_logbin;
+struct sl_logfile;
+
 typedef struct{
     char *logpath;          // full path to logfile
     sl_loglevel_e loglevel; // loglevel
     int addprefix;          // if !=0 add record type to each line(e.g. [ERR])
+    struct sl_logasync *async; // asynchronous writer or NULL
+    int usec;               // !=0 to add microseconds to timestamps
+    int fd;                 // log file (opened once)
+    struct sl_logbin *bin;  // formats of binary log or NULL
+    struct sl_logfile *file;// state of opened file and rotation
 } sl_log_t;
 
 extern sl_log_t *sl_globlog; // "global" log file
 
 sl_log_t *sl_createlog(const char *logpath, sl_loglevel_e level, int prefix);
+sl_log_t *sl_createlog_ext(const char *logpath, sl_loglevel_e level, int prefix, const sl_logopts_t *opts);
 void sl_deletelog(sl_log_t **log);
 int sl_putlogt(int timest, sl_log_t *log, sl_loglevel_e lvl, const char *fmt, ...);
+ssize_t sl_flushlog(sl_log_t *log);
+size_t sl_log_dropped(sl_log_t *log);
+ssize_t sl_decodelog(const char *binlog, FILE *out);
 // open "global" log
 #define OPENLOG(nm, lvl, prefix)   (sl_globlog = sl_createlog(nm, lvl, prefix))
 // shortcuts for different log levels; ..ADD - add message without timestamp
@@ -332,6 +405,50 @@ char *sl_getPSname(pid_t pid);
 // daemonize: reopen stdin/out/err as /dev/null, chdir to /, umask(0)
 int sl_daemonize(); // return -1 if failed, 0 on OK
 
+/******************************************************************************\
+                         Arena & pool allocators (mempool.c)
+\******************************************************************************/
+
+// alignment of memory blocks got from arena or pool
+#define SL_MEM_ALIGN        (16)
+// default size of arena's chunk
+#define SL_DEF_ARENACHUNK   (65536)
+// default amount of objects in pool's slab
+#define SL_DEF_POOLSLAB     (256)
+
+struct sl_memchunk;
+// arena (region) allocator: bump allocation from big chunks, everything is freed at once (not thread-safe)
+typedef struct{
+    struct sl_memchunk *head;   // current chunk (older chunks follow it)
+    size_t chunksize;           // size of each chunk
+    size_t used;                // bytes allocated after last reset
+} sl_arena_t;
+
+// pool of fixed-size objects with list of freed ones (not thread-safe)
+typedef struct{
+    struct sl_memchunk *slabs;  // current slab (older slabs follow it)
+    void *freelist;             // freed objects
+    size_t objsize;             // size of each object (aligned)
+    size_t nperslab;            // amount of objects in each slab
+    size_t nused;               // amount of objects in use
+} sl_pool_t;
+
+#define ARENA_ALLOC(arena, type, size)  ((type *)sl_arena_alloc(arena, size, sizeof(type)))
+#define POOL_ALLOC(pool, type)          ((type *)sl_pool_alloc(pool))
+#define POOL_FREE(pool, ptr)  do{if(ptr){sl_pool_free(pool, ptr); ptr = NULL;}}while(0)
+
+sl_arena_t *sl_arena_new(size_t chunksize);
+void *sl_arena_alloc(sl_arena_t *a, size_t N, size_t S);
+char *sl_arena_strdup(sl_arena_t *a, const char *s);
+void sl_arena_reset(sl_arena_t *a);
+void sl_arena_delete(sl_arena_t **a);
+
+sl_pool_t *sl_pool_new(size_t objsize, size_t nperslab);
+void *sl_pool_alloc(sl_pool_t *p);
+void sl_pool_free(sl_pool_t *p, void *obj);
+void sl_pool_reset(sl_pool_t *p);
+void sl_pool_delete(sl_pool_t **p);
+
 /******************************************************************************\
                          The original fifo_lifo.h
 \******************************************************************************/
@@ -344,6 +461,49 @@ sl_list_t *sl_list_push_tail(sl_list_t **lst, void *v);
 sl_list_t *sl_list_push(sl_list_t **lst, void *v);
 void *sl_list_pop(sl_list_t **lst);
 
+// intrusive list: user embeds `sl_list_t` into own structure, nodes aren't allocated/freed
+#define SL_CONTAINER_OF(ptr, type, member)  ((type *)((char *)(ptr) - offsetof(type, member)))
+sl_list_t *sl_ilist_push_tail(sl_list_t **lst, sl_list_t *node);
+sl_list_t *sl_ilist_push(sl_list_t **lst, sl_list_t *node);
+sl_list_t *sl_ilist_pop(sl_list_t **lst);
+
+// list with nodes taken from own pool (not thread-safe)
+typedef struct{
+    sl_list_t *head;        // list itself
+    sl_pool_t *pool;        // pool of nodes
+    size_t n;               // amount of nodes in list
+} sl_plist_t;
+
+sl_plist_t *sl_plist_new(size_t nperslab);
+sl_list_t *sl_plist_push_tail(sl_plist_t *l, void *v);
+sl_list_t *sl_plist_push(sl_plist_t *l, void *v);
+void *sl_plist_pop(sl_plist_t *l);
+void sl_plist_delete(sl_plist_t **l);
+
+/******************************************************************************\
+                         Lock-free queues (queue.c)
+\******************************************************************************/
+
+// bounded multi-producer/multi-consumer queue of pointers
+typedef struct sl_mpmc sl_mpmc_t;
+// unbounded multi-producer/single-consumer queue of pointers
+typedef struct sl_mpsc sl_mpsc_t;
+
+// NULL can't be pushed; `timeout` in seconds, <0 - wait forever
+sl_mpmc_t *sl_mpmc_new(size_t size);
+void sl_mpmc_delete(sl_mpmc_t **q);
+int sl_mpmc_push(sl_mpmc_t *q, void *data);
+void *sl_mpmc_pop(sl_mpmc_t *q);
+int sl_mpmc_push_wait(sl_mpmc_t *q, void *data, double timeout);
+void *sl_mpmc_pop_wait(sl_mpmc_t *q, double timeout);
+size_t sl_mpmc_size(sl_mpmc_t *q);
+
+sl_mpsc_t *sl_mpsc_new();
+void sl_mpsc_delete(sl_mpsc_t **q);
+int sl_mpsc_push(sl_mpsc_t *q, void *data);
+void *sl_mpsc_pop(sl_mpsc_t *q);
+void *sl_mpsc_pop_wait(sl_mpsc_t *q, double timeout);
+
 /******************************************************************************\
                          The original config.h
 \******************************************************************************/
@@ -381,9 +541,21 @@ typedef struct{
     size_t head;               // head index
     size_t tail;               // tail index
     pthread_mutex_t busy;   // mutex of buffer activity
+    int spsc;               // ==TRUE for lock-free single producer/single consumer buffer
+    size_t scanned;         // amount of bytes after `head` already checked for `scanbyte` absence
+    int scanbyte;           // last byte searched by `sl_RB_hasbyte`
+    int mirrored;           // ==TRUE if `data` is mapped twice: data[i+length] is data[i]
 } sl_ringbuffer_t;
 
+// flags for `sl_RB_new_ext`
+typedef enum{
+    SL_RB_SPSC = 1,         // lock-free single producer/single consumer
+    SL_RB_MIRROR = 2,       // mirrored memory: any data or free space is contiguous
+} sl_RB_flags_e;
+
 sl_ringbuffer_t *sl_RB_new(size_t size);
+sl_ringbuffer_t *sl_RB_new_spsc(size_t size);
+sl_ringbuffer_t *sl_RB_new_ext(size_t size, int flags);
 void sl_RB_delete(sl_ringbuffer_t **b);
 size_t sl_RB_read(sl_ringbuffer_t *b, uint8_t *s, size_t len);
 ssize_t sl_RB_readto(sl_ringbuffer_t *b, uint8_t byte, uint8_t *s, size_t len);
@@ -395,6 +567,12 @@ size_t sl_RB_freesize(sl_ringbuffer_t *b);
 void sl_RB_clearbuf(sl_ringbuffer_t *b);
 ssize_t sl_RB_readline(sl_ringbuffer_t *b, char *s, size_t len);
 size_t sl_RB_writestr(sl_ringbuffer_t *b, char *s);
+// zero-copy access: up to two contiguous spans of data (peek) or free space (reserve)
+int sl_RB_peek(sl_ringbuffer_t *b, struct iovec iov[2]);
+size_t sl_RB_consume(sl_ringbuffer_t *b, size_t len);
+int sl_RB_reserve(sl_ringbuffer_t *b, struct iovec iov[2]);
+size_t sl_RB_commit(sl_ringbuffer_t *b, size_t len);
+ssize_t sl_RB_readfd(sl_ringbuffer_t *b, int fd);
 
 /******************************************************************************\
                          The original socket.h
@@ -466,6 +644,37 @@ int sl_sock_open(sl_socktype_e type, const char *path, int isserver, int ai_sock
 
 // default max clients amount
 #define SL_DEF_MAXCLIENTS   (32)
+
+// server's event loop backend
+typedef enum{
+    SOCKEV_POLL = 0,    // poll() with 1ms timeout and scanning of all clients (default)
+    SOCKEV_EPOLL,       // edge-triggered epoll(): touch only ready sockets, sleep while idle
+    SOCKEV_AMOUNT
+} sl_sockevent_e;
+
+// default size of server clients' output queue
+#define SL_DEF_OUTQSIZE     (65536)
+
+// what to do when client's output queue is full
+typedef enum{
+    SOCKOQ_DISCONNECT = 0,  // disconnect slow client (default)
+    SOCKOQ_DROP,            // drop new messages until queue drains
+    SOCKOQ_AMOUNT
+} sl_sockoqpolicy_e;
+
+// extended server parameters for `sl_sock_run_server_ext` (zero-filled structure means defaults)
+typedef struct{
+    int maxclients;         // max clients amount (<1 - SL_DEF_MAXCLIENTS)
+    sl_sockevent_e evmode;  // event loop backend
+    int nworkers;           // >1 - amount of epoll() worker threads, <0 - THREAD_NUMBER workers, else single thread
+    int outqsize;           // size of clients' output queues (0 - SL_DEF_OUTQSIZE, <0 - blocking send without queue)
+    sl_sockoqpolicy_e oqpolicy; // output queue overflow policy
+} sl_sock_srvopts_t;
+
+struct sl_sock_srvdata;
+struct sl_sock_hindex;
+struct sl_sock_outq;
+struct sl_httprequest;
 // custom socket handlers: connect/disconnect/etc
 // max clients handler
 void sl_sock_maxclhandler(struct sl_sock *s, void (*h)(int));
@@ -478,7 +687,7 @@ void sl_sock_defmsghandler(struct sl_sock *s, sl_sock_hresult_e(*h)(struct sl_so
 
 typedef enum{
     SOCKM_RAW = 0,  // default sockets
-    SOCKM_GET,      // http methods - client should be closed after data processing
+    SOCKM_GET,      // http methods (while request is processed)
     SOCKM_PUT,
     SOCKM_POST,
     SOCKM_PATCH,
@@ -501,11 +710,11 @@ typedef struct sl_sock{
     char IP[INET_ADDRSTRLEN];   // client's IP address
     sl_sock_hitem_t *handlers;  // if non-NULL, run handler's thread when opened
     sl_sockmethod_e sockmethod; // method
-    uint64_t lineno;            // number of line read
-    int contlen;                // content length for POST method
-    int gotemptyline;           // == TRUE when found empty line in web request (to know that header is over)
-    char outbuffer[BUFSIZ];     // buffer for output data (if client is WEB)
-    size_t outplen;             // amount of bytes in `outbuffer`
+    uint64_t lineno;            // number of line (or HTTP request) read
+    struct sl_httprequest *http; // HTTP request parser (NULL for raw clients)
+    char *outbuffer;            // HTTP response being collected (its body follows space reserved for header)
+    size_t outbufsz;            // size of `outbuffer` (it grows as needed)
+    size_t outplen;             // length of response body
     // server-only items
     int maxclients;             // max clients amount
     void (*toomuch_handler)(int); // too much clients handler; it is running for client connected with number>maxclients (before closing its fd)
@@ -513,12 +722,26 @@ typedef struct sl_sock{
     void (*disconnect_handler)(struct sl_sock*); // client disconnected handler
     sl_sock_hresult_e(*defmsg_handler)(struct sl_sock *s, const char *str); // default message handler (the only without `handlers` array or instead of "BADKEY" answer
     struct sl_sock **clients;   // pointer to clients array for `sendall`
+    sl_sockevent_e evmode;      // server's event loop backend
+    int evfd;                   // eventfd to wake up sleeping server thread (or -1)
+    struct sl_sock_srvdata *srvdata; // internal data of server (clients' slots, workers)
+    struct sl_sock_hindex *hindex; // hash index of `handlers` keys
+    struct sl_sock_outq *outq;  // server client's output queue drained by server's event loop (or NULL)
+    int outqsize;               // size of clients' output queues (<1 - no queues)
+    sl_sockoqpolicy_e oqpolicy; // output queue overflow policy
+    // client-only items
+    pthread_mutex_t rmutex;     // mutex for `rcond`
+    pthread_cond_t rcond;       // reader thread got data or user freed space in `buffer`
+    int rbfull;                 // == TRUE when reader thread waits for free space in `buffer`
+    int linefd;                 // eventfd readable while `buffer` has full line (-1 until `sl_sock_linefd` called)
+    int lineready;              // == TRUE when `linefd` is readable
 } sl_sock_t;
 
 const char *sl_sock_hresult2str(sl_sock_hresult_e r);
 void sl_sock_delete(sl_sock_t **sock);
 sl_sock_t *sl_sock_run_client(sl_socktype_e type, const char *path, int bufsiz);
 sl_sock_t *sl_sock_run_server(sl_socktype_e type, const char *path, int bufsiz, sl_sock_hitem_t *handlers);
+sl_sock_t *sl_sock_run_server_ext(sl_socktype_e type, const char *path, int bufsiz, sl_sock_hitem_t *handlers, const sl_sock_srvopts_t *opts);
 void sl_sock_changemaxclients(sl_sock_t *sock, int val);
 int sl_sock_getmaxclients(sl_sock_t *sock);
 
@@ -526,8 +749,132 @@ ssize_t sl_sock_sendbinmessage(sl_sock_t *socket, const uint8_t *msg, size_t l);
 ssize_t sl_sock_sendbyte(sl_sock_t *socket, uint8_t byte);
 ssize_t sl_sock_sendstrmessage(sl_sock_t *socket, const char *msg);
 ssize_t sl_sock_readline(sl_sock_t *sock, char *str, size_t len);
+int sl_sock_waitline(sl_sock_t *sock, double timeout);
+ssize_t sl_sock_readline_wait(sl_sock_t *sock, char *str, size_t len, double timeout);
+int sl_sock_linefd(sl_sock_t *sock);
 int sl_sock_sendall(sl_sock_t *sock, uint8_t *data, size_t len);
 
 sl_sock_hresult_e sl_sock_inthandler(sl_sock_t *client, sl_sock_hitem_t *hitem, const char *str);
 sl_sock_hresult_e sl_sock_dblhandler(sl_sock_t *client, sl_sock_hitem_t *hitem, const char *str);
 sl_sock_hresult_e sl_sock_strhandler(sl_sock_t *client, sl_sock_hitem_t *hitem, const char *str);
+
+/******************************************************************************\
+                         HTTP request parser (http.c)
+\******************************************************************************/
+
+// state of request parsing
+typedef enum{
+    SL_HTTP_HEAD = 0,   // waiting for request line and headers
+    SL_HTTP_BODY,       // waiting for body of Content-Length bytes
+    SL_HTTP_CHUNKS,     // waiting for chunks of body
+    SL_HTTP_DONE,       // request is complete
+    SL_HTTP_ERROR       // bad request
+} sl_httpstate_e;
+
+// piece of data (not zero-terminated)
+typedef struct{
+    const char *ptr;
+    size_t len;
+} sl_strslice_t;
+
+typedef struct{
+    sl_strslice_t name;
+    sl_strslice_t value;
+} sl_httphdr_t;
+
+// max amount of headers stored in request (the rest are checked but not stored)
+#define SL_HTTP_MAXHDRS     (32)
+
+// HTTP/1.x request: all slices point into parsed data
+typedef struct sl_httprequest{
+    sl_httpstate_e state;
+    sl_sockmethod_e method;     // method (SOCKM_RAW if unknown)
+    int minor;                  // minor version: HTTP/1.minor
+    int keepalive;              // == TRUE if connection stays open after response
+    int expectcont;             // == TRUE if client waits for "100 Continue" before sending body
+    sl_strslice_t target;       // request target (path)
+    sl_strslice_t body;         // body (when done; chunked body is decoded)
+    sl_httphdr_t headers[SL_HTTP_MAXHDRS];
+    int nheaders;               // amount of headers stored
+    size_t reqlen;              // length of whole request (when done)
+    // parser's data
+    const char *base;           // data of the last call
+    size_t start;               // offset of request line (empty lines before it are skipped)
+    size_t pos;                 // offset of the first byte not parsed yet
+    size_t hdrlen;              // length of head with empty line after headers
+    size_t contlen;             // Content-Length or size of current chunk
+    int hascontlen;             // == TRUE if there was Content-Length header
+    int chunked;                // == TRUE for chunked body
+    int chunkstage;             // stage of chunked body parsing
+} sl_httpreq_t;
+
+void sl_http_init(sl_httpreq_t *r);
+sl_httpstate_e sl_http_parse(sl_httpreq_t *r, char *buf, size_t len);
+sl_sockmethod_e sl_http_method(const char *str, size_t len);
+const sl_strslice_t *sl_http_header(const sl_httpreq_t *r, const char *name);
+
+/******************************************************************************\
+                         Hash map (hashmap.c)
+\******************************************************************************/
+
+// type of hash map keys
+typedef enum{
+    SL_HMAP_STRKEYS,    // strings (not copied: they should live while map lives)
+    SL_HMAP_INTKEYS,    // int64_t
+} sl_hmapkey_e;
+
+// open addressing (Robin Hood) hash map of `void*` values (not thread-safe)
+typedef struct sl_hmap sl_hmap_t;
+
+sl_hmap_t *sl_hmap_new(sl_hmapkey_e type, size_t nitems);
+void sl_hmap_delete(sl_hmap_t **m);
+size_t sl_hmap_count(const sl_hmap_t *m);
+// string keys
+int sl_hmap_put(sl_hmap_t *m, const char *key, void *val);
+void *sl_hmap_get(const sl_hmap_t *m, const char *key);
+int sl_hmap_getn(const sl_hmap_t *m, const char *key, size_t len, void **val);
+int sl_hmap_del(sl_hmap_t *m, const char *key);
+// integer keys
+int sl_hmap_puti(sl_hmap_t *m, int64_t key, void *val);
+int sl_hmap_geti(const sl_hmap_t *m, int64_t key, void **val);
+int sl_hmap_deli(sl_hmap_t *m, int64_t key);
+// bulk build: values are pointers to array items
+sl_hmap_t *sl_hmap_options(sl_option_t *options, int byshort);
+sl_hmap_t *sl_hmap_hitems(sl_sock_hitem_t *items);
+
+/******************************************************************************\
+                         Binary search & sorted index (search.c)
+\******************************************************************************/
+
+// generic search in sorted array: cmp(key, item) like for `bsearch`; return index in [0, n]
+size_t sl_lower_bound(const void *key, const void *base, size_t n, size_t size, int (*cmp)(const void*, const void*));
+size_t sl_upper_bound(const void *key, const void *base, size_t n, size_t size, int (*cmp)(const void*, const void*));
+
+/*
+ * SL_BSEARCH(name, type, less) declares branchless typed search in sorted arrays:
+ *      size_t name_lower(const type *a, size_t n, type key) - index of first item >= key
+ *      size_t name_upper(const type *a, size_t n, type key) - index of first item > key
+ * `less(a, b)` is a function or macro returning nonzero if a < b, e.g. SL_LESS
+ */
+#define SL_LESS(a, b)   ((a) < (b))
+#define SL_BSEARCH(name, type, less)                                            \
+static inline size_t name ## _lower(const type *a, size_t n, type key){         \
+    const type *b = a;                                                          \
+    if(!n) return 0;                                                            \
+    while(n > 1){ size_t half = n / 2; b = less(b[half], key) ? b + half : b; n -= half; } \
+    return (size_t)(b - a) + (less(*b, key) ? 1 : 0); }                         \
+static inline size_t name ## _upper(const type *a, size_t n, type key){         \
+    const type *b = a;                                                          \
+    if(!n) return 0;                                                            \
+    while(n > 1){ size_t half = n / 2; b = less(key, b[half]) ? b : b + half; n -= half; } \
+    return (size_t)(b - a) + (less(key, *b) ? 0 : 1); }
+
+// sorted index of string keys of user's array (the array isn't copied)
+typedef struct sl_sortidx sl_sortidx_t;
+
+sl_sortidx_t *sl_sortidx_new(const void *base, size_t n, size_t size, size_t keyoff);
+sl_sortidx_t *sl_sortidx_options(sl_option_t *options);
+sl_sortidx_t *sl_sortidx_hitems(sl_sock_hitem_t *items);
+int sl_sortidx_find(const sl_sortidx_t *x, const char *key);
+int sl_sortidx_findn(const sl_sortidx_t *x, const char *key, size_t len);
+void sl_sortidx_delete(sl_sortidx_t **x);